@@ -0,0 +1,49 @@
+# Writes the compiled SPIR-V in SHADER_DIR into OUTPUT as a constexpr table of 32-bit words
+# cmake -DSHADER_DIR=<dir with .spv files> -DOUTPUT=<header> -P EmbedShaders.cmake
+
+file(GLOB spirv_files ${SHADER_DIR}/*.spv)
+list(SORT spirv_files)
+
+set(arrays "")
+set(entries "")
+
+foreach(spirv ${spirv_files})
+    get_filename_component(name ${spirv} NAME)
+    string(MAKE_C_IDENTIFIER ${name} identifier)
+
+    # SPIR-V is a stream of little-endian words: "aabbccdd" -> 0xddccbbaa
+    file(READ ${spirv} hex HEX)
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u," words "${hex}")
+    string(REGEX REPLACE "(0x........u,0x........u,0x........u,0x........u,0x........u,0x........u,0x........u,0x........u,)"
+           "\\1\n        " words "${words}")
+
+    string(APPEND arrays "    inline constexpr uint32_t ${identifier}[] = {\n        ${words}\n    };\n\n")
+    string(APPEND entries "        { \"${name}\", ${identifier}, sizeof(${identifier}) / sizeof(uint32_t) },\n")
+endforeach()
+
+set(content "// Generated by cmake/EmbedShaders.cmake, do not edit\n\
+#ifndef VULKAN_COURSE_EMBEDDEDSHADERS_HPP\n\
+#define VULKAN_COURSE_EMBEDDEDSHADERS_HPP\n\n\n\
+#include <cstddef>\n\
+#include <cstdint>\n\n\n\
+namespace embedded_shaders {\n\
+${arrays}\
+    struct Entry {\n\
+        const char* name;\n\
+        const uint32_t* code;\n\
+        size_t wordCount;\n\
+    };\n\n\
+    inline constexpr Entry shaders[] = {\n\
+${entries}\
+    };\n\
+}\n\n\n\
+#endif\n")
+
+# Only touch the header when the shaders changed, so the registry isn't rebuilt for nothing
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} previous)
+endif()
+
+if(NOT "${previous}" STREQUAL "${content}")
+    file(WRITE ${OUTPUT} "${content}")
+endif()
@@ -0,0 +1,20 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec2 fragTex;
+
+// Every loaded texture, partially bound (slots without a texture are never read)
+layout (set = 1, binding = 0) uniform sampler2D textureSamplers[];
+
+// Only push constant left, the model matrices come from the object buffer
+layout (push_constant) uniform PushMaterial {
+    uint textureIndex;
+} pushMaterial;
+
+layout (location = 0) out vec4 outColour; // Final out colour (must also be have location)
+
+void main() {
+    // Index is the same for the whole draw, so it doesn't need nonuniformEXT
+    outColour = texture(textureSamplers[pushMaterial.textureIndex], fragTex);
+}
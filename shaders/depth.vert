@@ -0,0 +1,20 @@
+#version 450
+
+// Depth pre-pass: positions only, the colour pass draws the same meshes again with an EQUAL depth test
+layout (location = 0) in vec3 pos;
+
+struct ObjectData {
+    mat4 model;
+    mat4 modelViewProjection;
+};
+
+layout (std430, set = 0, binding = 1) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
+
+// Same expression as shader.vert, both invariant so the depths match exactly
+invariant gl_Position;
+
+void main() {
+    gl_Position = objectBuffer.objects[gl_InstanceIndex].modelViewProjection * vec4(pos, 1.0);
+}
@@ -3,19 +3,34 @@
 layout(input_attachment_index = 0, binding = 0) uniform subpassInput inputColour; // Colour output from subpass 1
 layout(input_attachment_index = 1, binding = 1) uniform subpassInput inputDepth;  // Depth output from subpass 1
 
+// Specialization constants, each pipeline variant only keeps the branch of its mode
+const int VIEW_COLOUR = 0;
+const int VIEW_DEPTH = 1;
+const int VIEW_SPLIT = 2; // Colour on the left, depth on the right
+
+layout(constant_id = 0) const int VIEW_MODE = VIEW_SPLIT;
+layout(constant_id = 1) const uint SPLIT_X = 683; // Half the swap chain width
+layout(constant_id = 2) const float DEPTH_LOWER_BOUND = 0.98;
+layout(constant_id = 3) const float DEPTH_UPPER_BOUND = 1.0;
+
 layout(location = 0) out vec4 colour;
 
-void main() {
-    int xHalf = 1366 / 2;
+vec4 colourView() {
+    return subpassLoad(inputColour).rgba;
+}
 
-    if (gl_FragCoord.x > xHalf) {
-        float lowerBound = 0.98;
-        float upperBound = 1;
+vec4 depthView() {
+    float depth = subpassLoad(inputDepth).r;
+    float depthColourScaled = 1.0f - ((depth - DEPTH_LOWER_BOUND) / (DEPTH_UPPER_BOUND - DEPTH_LOWER_BOUND));
+    return vec4(subpassLoad(inputColour).rgb * depthColourScaled, 1.0f);
+}
 
-        float depth = subpassLoad(inputDepth).r;
-        float depthColourScaled = 1.0f - ((depth - lowerBound) / (upperBound - lowerBound));
-        colour = vec4(subpassLoad(inputColour).rgb * depthColourScaled, 1.0f);
-    } else  {
-        colour = subpassLoad(inputColour).rgba;
+void main() {
+    if (VIEW_MODE == VIEW_COLOUR) {
+        colour = colourView();
+    } else if (VIEW_MODE == VIEW_DEPTH) {
+        colour = depthView();
+    } else {
+        colour = gl_FragCoord.x > SPLIT_X ? depthView() : colourView();
     }
-}
\ No newline at end of file
+}
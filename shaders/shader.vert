@@ -9,21 +9,25 @@ layout (set = 0, binding = 0) uniform UboViewProjection {
     mat4 view;
 } uboViewProjection;
 
-// NOT IN USE, LEFT FOR REFERENCE
-layout (set = 0, binding = 1) uniform UboModel {
+// Record of every object, the draw's first instance is the index of its object
+struct ObjectData {
     mat4 model;
-} uboModel;
+    mat4 modelViewProjection;
+};
 
-layout (push_constant) uniform PushModel {
-    mat4 model;
-}   pushModel;
+layout (std430, set = 0, binding = 1) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
 
 layout (location = 0) out vec3 fragCol;
 layout (location = 1) out vec2 fragTex;
 
+// The depth pre-pass (depth.vert) has to produce the exact same depths for the EQUAL test
+invariant gl_Position;
+
 void main() {
-    gl_Position = uboViewProjection.projection * uboViewProjection.view * pushModel.model * vec4(pos, 1.0);
+    gl_Position = objectBuffer.objects[gl_InstanceIndex].modelViewProjection * vec4(pos, 1.0);
 
     fragCol = col;
     fragTex = tex;
-}
\ No newline at end of file
+}
@@ -0,0 +1,28 @@
+#include "DeletionQueue.hpp"
+
+
+DeletionQueue::DeletionQueue() = default;
+
+DeletionQueue::~DeletionQueue() = default;
+
+void DeletionQueue::push(uint64_t retireValue, std::function<void()> deleter) {
+    deletions_.push_back({ retireValue, std::move(deleter) });
+}
+
+void DeletionQueue::flush(uint64_t completedValue) {
+    // Oldest first, stop at the first one that may still be in flight
+    while (!deletions_.empty() && deletions_.front().retireValue <= completedValue) {
+        // Pop before running, a deleter may push more deletions
+        std::function<void()> deleter = std::move(deletions_.front().deleter);
+        deletions_.pop_front();
+        deleter();
+    }
+}
+
+void DeletionQueue::flushAll() {
+    while (!deletions_.empty()) {
+        std::function<void()> deleter = std::move(deletions_.front().deleter);
+        deletions_.pop_front();
+        deleter();
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef VULKAN_COURSE_DELETIONQUEUE_HPP
+#define VULKAN_COURSE_DELETIONQUEUE_HPP
+
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+
+// Destroys GPU objects once every submission that could have used them has finished on the GPU
+// Submissions are numbered by the queue's timeline semaphore (GpuTimeline)
+class DeletionQueue {
+    public:
+        DeletionQueue();
+        ~DeletionQueue();
+
+        // retireValue: timeline value of the newest submission that may still reference what the deleter destroys
+        void push(uint64_t retireValue, std::function<void()> deleter);
+
+        // Runs the deleters of every submission that completed by completedValue
+        void flush(uint64_t completedValue);
+
+        // Device is idle, everything can go
+        void flushAll();
+
+    private:
+        struct Deletion {
+            uint64_t retireValue;
+            std::function<void()> deleter;
+        };
+
+        std::deque<Deletion> deletions_; // Pushed in timeline order
+};
+
+
+#endif
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "DescriptorAllocator.hpp"
+
+
+// Each new pool doubles in size up to this many sets
+static const uint32_t MAX_SETS_PER_POOL = 4096;
+
+DescriptorAllocator::DescriptorAllocator() = default;
+
+DescriptorAllocator::~DescriptorAllocator() = default;
+
+void DescriptorAllocator::init(VkDevice device, uint32_t setsPerPool, std::vector<DescriptorPoolRatio> ratios) {
+    device_ = device;
+    setsPerPool_ = setsPerPool;
+    ratios_ = std::move(ratios);
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+    if (!currentPool_) currentPool_ = getPool();
+
+    VkDescriptorSetAllocateInfo setAllocateInfo{};
+    setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocateInfo.descriptorPool = currentPool_;
+    setAllocateInfo.descriptorSetCount = 1;
+    setAllocateInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet descriptorSet{};
+    VkResult result = vkAllocateDescriptorSets(device_, &setAllocateInfo, &descriptorSet);
+
+    // Current pool is full (or too fragmented for this layout), retry once from a fresh one
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        fullPools_.push_back(currentPool_);
+        currentPool_ = getPool();
+
+        setAllocateInfo.descriptorPool = currentPool_;
+        result = vkAllocateDescriptorSets(device_, &setAllocateInfo, &descriptorSet);
+    }
+
+    if (result != VK_SUCCESS) throw std::runtime_error("Failed to allocate a Descriptor Set");
+
+    return descriptorSet;
+}
+
+void DescriptorAllocator::reset() {
+    // Every set allocated so far becomes invalid, the pools are kept for the next allocations
+    if (currentPool_) fullPools_.push_back(currentPool_);
+
+    for (auto pool : fullPools_) {
+        vkResetDescriptorPool(device_, pool, 0);
+        freePools_.push_back(pool);
+    }
+
+    fullPools_.clear();
+    currentPool_ = VK_NULL_HANDLE;
+}
+
+void DescriptorAllocator::clean() {
+    reset();
+
+    for (auto pool : freePools_) {
+        vkDestroyDescriptorPool(device_, pool, nullptr);
+    }
+
+    freePools_.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::getPool() {
+    if (!freePools_.empty()) {
+        VkDescriptorPool pool = freePools_.back();
+        freePools_.pop_back();
+
+        return pool;
+    }
+
+    VkDescriptorPool pool = createPool(setsPerPool_);
+
+    // Allocators that keep running out grow their pools, so the chain stays short
+    setsPerPool_ = std::min(setsPerPool_ * 2, MAX_SETS_PER_POOL);
+
+    return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount) {
+    std::vector<VkDescriptorPoolSize> poolSizes;
+
+    for (const auto& ratio : ratios_) {
+        poolSizes.push_back({ ratio.type, std::max(static_cast<uint32_t>(ratio.ratio * static_cast<float>(setCount)), 1u) });
+    }
+
+    VkDescriptorPoolCreateInfo poolCreateInfo{};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.maxSets = setCount;
+    poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCreateInfo.pPoolSizes = poolSizes.data();
+
+    VkDescriptorPool pool{};
+    VkResult result = vkCreateDescriptorPool(device_, &poolCreateInfo, nullptr, &pool);
+
+    if (result != VK_SUCCESS) throw std::runtime_error("Failed to create a Descriptor Pool");
+
+    return pool;
+}
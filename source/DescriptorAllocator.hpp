@@ -0,0 +1,41 @@
+#ifndef VULKAN_COURSE_DESCRIPTORALLOCATOR_HPP
+#define VULKAN_COURSE_DESCRIPTORALLOCATOR_HPP
+
+
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+
+// Descriptors of one type per set, a pool holds (sets per pool * ratio) of them
+struct DescriptorPoolRatio {
+    VkDescriptorType type;
+    float ratio;
+};
+
+// Hands out descriptor sets from a chain of pools, a new (larger) pool is created whenever the current one is full
+// Sets are never freed one by one: long lived allocators are cleaned with the renderer, per frame ones are reset in bulk
+class DescriptorAllocator {
+    public:
+        DescriptorAllocator();
+        ~DescriptorAllocator();
+        void init(VkDevice device, uint32_t setsPerPool, std::vector<DescriptorPoolRatio> ratios);
+        VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+        void reset();
+        void clean();
+
+    private:
+        VkDescriptorPool getPool();
+        VkDescriptorPool createPool(uint32_t setCount);
+
+    private:
+        VkDevice device_{};
+        std::vector<DescriptorPoolRatio> ratios_;
+        uint32_t setsPerPool_{};
+        VkDescriptorPool currentPool_{};
+        std::vector<VkDescriptorPool> fullPools_;
+        std::vector<VkDescriptorPool> freePools_; // Reset pools, reused before creating new ones
+};
+
+
+#endif
@@ -0,0 +1,291 @@
+#include "FrameCapture.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+#include "spdlog/spdlog.h"
+#include <stb_image_write.h>
+
+#include "GpuTimeline.hpp"
+#include "ThreadPool.hpp"
+#include "Utilities.hpp"
+
+
+FrameCapture::FrameCapture() = default;
+
+FrameCapture::~FrameCapture() = default;
+
+void FrameCapture::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t bufferCount) {
+    physicalDevice_ = physicalDevice;
+    device_ = device;
+    readbacks_ = std::vector<Readback>(bufferCount);
+
+    // The CPU reads every byte of a capture, cached memory makes that much faster (invalidated before reading)
+    memoryFlags_ = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+    if (findMemoryTypeIndex(physicalDevice, UINT32_MAX, memoryFlags_) == UINT32_MAX) {
+        memoryFlags_ = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    }
+}
+
+void FrameCapture::clean() {
+    for (auto& readback : readbacks_) {
+        if (readback.state == ReadbackState::ENCODING) {
+            readback.encode.get();
+        } else if (readback.state == ReadbackState::COPYING && readback.timelineValue != UINT64_MAX) {
+            // The device is idle, so the copy is there: don't lose the last captures on exit
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = readback.memory;
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+            vkInvalidateMappedMemoryRanges(device_, 1, &range);
+
+            encode(readback.mapped, readback.imageFormat, readback.extent, readback.path, readback.format, readback.log);
+        }
+
+        destroyReadback(readback);
+    }
+
+    readbacks_.clear();
+    requests_.clear();
+    recorded_ = UINT32_MAX;
+}
+
+void FrameCapture::requestCapture(const std::string& path, CaptureFormat format) {
+    requests_.push_back({ path, format });
+}
+
+void FrameCapture::setRecording(const std::string& directory, CaptureFormat format) {
+    if (!directory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        if (error) {
+            spdlog::warn("[Vulkan-Renderer] Can't create capture directory {}: {}", directory, error.message());
+            return;
+        }
+
+        spdlog::info("[Vulkan-Renderer] Recording frames to {}", directory);
+    }
+
+    recordingDirectory_ = directory;
+    recordingFormat_ = format;
+    recordingFrame_ = 0;
+    droppingFrames_ = false;
+}
+
+bool FrameCapture::isCapturing() const {
+    return !requests_.empty() || !recordingDirectory_.empty();
+}
+
+void FrameCapture::recordCopy(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkExtent2D extent) {
+    if (!isCapturing()) return;
+
+    if (!isSupportedFormat(format)) {
+        if (!formatWarned_) {
+            spdlog::warn("[Vulkan-Renderer] Swap chain format {} can't be captured", static_cast<int>(format));
+        }
+
+        formatWarned_ = true;
+        return;
+    }
+
+    // Recorded frames are numbered whether they are captured or not
+    std::string path;
+    CaptureFormat captureFormat{};
+    bool single = !requests_.empty();
+
+    if (single) {
+        path = requests_.front().path;
+        captureFormat = requests_.front().format;
+    } else {
+        char fileName[32];
+        std::snprintf(fileName, sizeof(fileName), "frame_%06llu.%s", static_cast<unsigned long long>(recordingFrame_),
+                      recordingFormat_ == CaptureFormat::PNG ? "png" : "raw");
+
+        path = (std::filesystem::path(recordingDirectory_) / fileName).string();
+        captureFormat = recordingFormat_;
+    }
+
+    if (!recordingDirectory_.empty()) ++recordingFrame_;
+
+    uint32_t index = 0;
+
+    while (index < readbacks_.size() && readbacks_[index].state != ReadbackState::FREE) ++index;
+
+    // Every buffer is busy: skip the frame rather than wait (a single capture is taken next frame)
+    if (index == readbacks_.size()) {
+        if (!single && !droppingFrames_) {
+            spdlog::warn("[Vulkan-Renderer] Frame capture can't keep up, skipping frames");
+        }
+
+        droppingFrames_ = !single;
+        return;
+    }
+
+    droppingFrames_ = false;
+
+    if (single) requests_.pop_front();
+
+    Readback& readback = readbacks_[index];
+    VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+    // Sized for the largest swap chain so far, free buffers are neither read nor written by anyone
+    if (readback.size < size) {
+        destroyReadback(readback);
+        createReadback(readback, size);
+    }
+
+    readback.state = ReadbackState::COPYING;
+    readback.timelineValue = UINT64_MAX;
+    readback.path = path;
+    readback.format = captureFormat;
+    readback.imageFormat = format;
+    readback.extent = extent;
+    readback.log = single;
+    recorded_ = index;
+
+    // The render pass left the image in PRESENT_SRC, its external dependency already made the colour writes visible to
+    // transfers: this only has to chain on to it
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = 0;
+    imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = image;
+    imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+    VkBufferImageCopy copyRegion{};
+    copyRegion.bufferOffset = 0;
+    copyRegion.bufferRowLength = 0; // Tightly packed rows
+    copyRegion.bufferImageHeight = 0;
+    copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    copyRegion.imageOffset = { 0, 0, 0 };
+    copyRegion.imageExtent = { extent.width, extent.height, 1 };
+
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &copyRegion);
+
+    // Back to PRESENT_SRC for presentation (which waits on the submission's semaphore), and the copy to the host
+    imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    imageBarrier.dstAccessMask = 0;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = readback.buffer;
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = size;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0, 0, nullptr, 1, &bufferBarrier, 1, &imageBarrier);
+}
+
+void FrameCapture::setSubmitted(uint64_t timelineValue) {
+    if (recorded_ == UINT32_MAX) return;
+
+    readbacks_[recorded_].timelineValue = timelineValue;
+    recorded_ = UINT32_MAX;
+}
+
+void FrameCapture::update(GpuTimeline& timeline, ThreadPool& threadPool) {
+    for (auto& readback : readbacks_) {
+        if (readback.state == ReadbackState::ENCODING &&
+            readback.encode.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            readback.encode.get();
+            readback.state = ReadbackState::FREE;
+        }
+
+        if (readback.state != ReadbackState::COPYING || readback.timelineValue == UINT64_MAX ||
+            !timeline.isComplete(readback.timelineValue)) continue;
+
+        // Cached memory isn't coherent, the copy has to be made visible to the CPU first (no-op when it is coherent)
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = readback.memory;
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+        vkInvalidateMappedMemoryRanges(device_, 1, &range);
+
+        // The worker reads the mapped memory itself, the buffer stays out of use until it is done
+        readback.state = ReadbackState::ENCODING;
+        readback.encode = threadPool.submit([pixels = readback.mapped, imageFormat = readback.imageFormat,
+                                             extent = readback.extent, path = readback.path, format = readback.format,
+                                             log = readback.log] {
+            encode(pixels, imageFormat, extent, path, format, log);
+        });
+    }
+}
+
+bool FrameCapture::isSupportedFormat(VkFormat format) {
+    return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB ||
+           format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+void FrameCapture::encode(const void* pixels, VkFormat imageFormat, VkExtent2D extent, const std::string& path,
+                          CaptureFormat format, bool log) {
+    size_t pixelCount = static_cast<size_t>(extent.width) * extent.height;
+    std::vector<uint8_t> rgba(pixelCount * 4);
+    std::memcpy(rgba.data(), pixels, rgba.size());
+
+    // Swap chains are often BGRA, and their alpha means nothing (the window is opaque)
+    bool bgra = imageFormat == VK_FORMAT_B8G8R8A8_UNORM || imageFormat == VK_FORMAT_B8G8R8A8_SRGB;
+
+    for (size_t i = 0; i < pixelCount; ++i) {
+        if (bgra) std::swap(rgba[i * 4], rgba[i * 4 + 2]);
+
+        rgba[i * 4 + 3] = 255;
+    }
+
+    bool written;
+
+    if (format == CaptureFormat::PNG) {
+        written = stbi_write_png(path.c_str(), static_cast<int>(extent.width), static_cast<int>(extent.height), 4,
+                                 rgba.data(), static_cast<int>(extent.width * 4)) != 0;
+    } else {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(rgba.data()), static_cast<std::streamsize>(rgba.size()));
+        written = file.good();
+    }
+
+    if (!written) {
+        spdlog::warn("[Vulkan-Renderer] Failed to write capture {}", path);
+    } else if (log) {
+        spdlog::info("[Vulkan-Renderer] Captured {}x{} frame to {}", extent.width, extent.height, path);
+    }
+}
+
+void FrameCapture::createReadback(Readback& readback, VkDeviceSize size) {
+    createBuffer(physicalDevice_, device_, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, memoryFlags_,
+                 &readback.buffer, &readback.memory, MemoryCategory::STAGING);
+
+    vkMapMemory(device_, readback.memory, 0, VK_WHOLE_SIZE, 0, &readback.mapped);
+    readback.size = size;
+}
+
+void FrameCapture::destroyReadback(Readback& readback) {
+    if (!readback.buffer) return;
+
+    vkUnmapMemory(device_, readback.memory);
+    vkDestroyBuffer(device_, readback.buffer, nullptr);
+    freeMemory(device_, readback.memory);
+
+    readback.buffer = VK_NULL_HANDLE;
+    readback.memory = VK_NULL_HANDLE;
+    readback.mapped = nullptr;
+    readback.size = 0;
+}
@@ -0,0 +1,99 @@
+#ifndef VULKAN_COURSE_FRAMECAPTURE_HPP
+#define VULKAN_COURSE_FRAMECAPTURE_HPP
+
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+
+class GpuTimeline;
+class ThreadPool;
+
+// File written for a captured frame: PNG, or the bare RGBA8 rows (width * 4 bytes each, top to bottom) for video tools
+enum class CaptureFormat {
+    PNG,
+    RAW
+};
+
+// Copies presented frames into host visible readback buffers and encodes them on worker threads
+// Nothing waits: copies are read once their frame's timeline value has completed, and a frame is skipped (never
+// stalled) when every buffer is still being copied to or encoded
+class FrameCapture {
+    public:
+        FrameCapture();
+        ~FrameCapture();
+        void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t bufferCount);
+
+        // The device must be idle, copies not encoded yet are encoded before returning
+        void clean();
+
+        // Next frame to a file
+        void requestCapture(const std::string& path, CaptureFormat format);
+
+        // Every frame to <directory>/frame_<number>, an empty directory stops recording
+        void setRecording(const std::string& directory, CaptureFormat format);
+        [[nodiscard]] bool isCapturing() const;
+
+        // After the render pass: copies the swap chain image (in PRESENT_SRC, and left there) when a capture is due
+        void recordCopy(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkExtent2D extent);
+
+        // Timeline value of the submission with the copy recorded last
+        void setSubmitted(uint64_t timelineValue);
+
+        // Hands completed copies to the workers and takes back the buffers they are done with
+        void update(GpuTimeline& timeline, ThreadPool& threadPool);
+
+    private:
+        enum class ReadbackState {
+            FREE,
+            COPYING, // Recorded, GPU not done yet
+            ENCODING
+        };
+
+        struct Readback {
+            VkBuffer buffer{};
+            VkDeviceMemory memory{};
+            void* mapped{};
+            VkDeviceSize size{};
+            ReadbackState state{ReadbackState::FREE};
+            uint64_t timelineValue{UINT64_MAX}; // UINT64_MAX until submitted
+            std::future<void> encode;
+            std::string path;
+            CaptureFormat format{};
+            VkFormat imageFormat{};
+            VkExtent2D extent{};
+            bool log{false}; // Single captures are logged, recorded frames aren't
+        };
+
+        struct CaptureRequest {
+            std::string path;
+            CaptureFormat format;
+        };
+
+        static bool isSupportedFormat(VkFormat format);
+        static void encode(const void* pixels, VkFormat imageFormat, VkExtent2D extent, const std::string& path,
+                           CaptureFormat format, bool log);
+        void createReadback(Readback& readback, VkDeviceSize size);
+        void destroyReadback(Readback& readback);
+
+    private:
+        VkPhysicalDevice physicalDevice_{};
+        VkDevice device_{};
+        VkMemoryPropertyFlags memoryFlags_{};
+        std::vector<Readback> readbacks_;
+        uint32_t recorded_{UINT32_MAX}; // Readback of the copy waiting for its submission
+        std::deque<CaptureRequest> requests_;
+        std::string recordingDirectory_;
+        CaptureFormat recordingFormat_{};
+        uint64_t recordingFrame_{}; // Numbers skipped frames too, gaps in the files show them
+        bool droppingFrames_{false}; // Warn once per run of skipped frames
+        bool formatWarned_{false};
+};
+
+
+#endif
@@ -0,0 +1,68 @@
+#include <cmath>
+#include <thread>
+
+#include "FrameLimiter.hpp"
+
+
+FrameLimiter::FrameLimiter(double maxFps) {
+    setMaxFps(maxFps);
+}
+
+FrameLimiter::~FrameLimiter() = default;
+
+void FrameLimiter::setMaxFps(double maxFps) {
+    maxFps_ = maxFps > 0.0 ? maxFps : 0.0;
+    frameTime_ = maxFps_ > 0.0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / maxFps_))
+                               : Clock::duration::zero();
+
+    // Start a new schedule from the next frame
+    nextFrame_ = {};
+}
+
+double FrameLimiter::getMaxFps() const {
+    return maxFps_;
+}
+
+void FrameLimiter::wait() {
+    if (frameTime_ == Clock::duration::zero()) return;
+
+    Clock::time_point now = Clock::now();
+
+    // More than a frame behind (first frame, hitch, minimised window): restart the schedule rather than rushing
+    // through the missed frames to catch up
+    if (now - nextFrame_ > frameTime_) {
+        nextFrame_ = now;
+    } else {
+        sleepUntil(nextFrame_);
+    }
+
+    // Frames are due at fixed intervals, so the time spent waiting doesn't drift
+    nextFrame_ += frameTime_;
+}
+
+void FrameLimiter::sleepUntil(Clock::time_point deadline) {
+    while (std::chrono::duration<double>(deadline - Clock::now()).count() > sleepEstimate_) {
+        Clock::time_point start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        double slept = std::chrono::duration<double>(Clock::now() - start).count();
+
+        // Welford's running variance, the estimate is one standard deviation above the mean so oversleeping is rare
+        ++sleepCount_;
+        double delta = slept - sleepMean_;
+        sleepMean_ += delta / static_cast<double>(sleepCount_);
+        sleepM2_ += delta * (slept - sleepMean_);
+        sleepEstimate_ = sleepMean_ + std::sqrt(sleepM2_ / static_cast<double>(sleepCount_ - 1));
+
+        // Forget old samples every now and then, the scheduler behaves differently under load
+        if (sleepCount_ > 1000) {
+            sleepMean_ = sleepEstimate_;
+            sleepM2_ = 0.0;
+            sleepCount_ = 1;
+        }
+    }
+
+    // Spin the rest, yielding so another thread that is ready can still run
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef VULKAN_COURSE_FRAMELIMITER_HPP
+#define VULKAN_COURSE_FRAMELIMITER_HPP
+
+
+#include <chrono>
+#include <cstdint>
+
+
+// Caps the frame rate on the CPU: sleeps until shortly before the next frame is due and spins the rest, the OS wakes
+// threads up too late to sleep the whole way, spinning the whole way burns a core
+class FrameLimiter {
+    public:
+        explicit FrameLimiter(double maxFps = 0.0);
+        ~FrameLimiter();
+
+        // 0 disables the limiter
+        void setMaxFps(double maxFps);
+        [[nodiscard]] double getMaxFps() const;
+
+        // Blocks until the next frame is due
+        void wait();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        void sleepUntil(Clock::time_point deadline);
+
+    private:
+        double maxFps_{};
+        Clock::duration frameTime_{};
+        Clock::time_point nextFrame_{};
+
+        // How long a 1 ms sleep really takes (running mean and variance), sleeping stops this far before a deadline
+        double sleepEstimate_{5e-3};
+        double sleepMean_{5e-3};
+        double sleepM2_{};
+        uint64_t sleepCount_{1};
+};
+
+
+#endif
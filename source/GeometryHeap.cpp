@@ -0,0 +1,281 @@
+#include "GeometryHeap.hpp"
+
+#include "Utilities.hpp"
+
+
+GeometryHeap::GeometryHeap() = default;
+
+GeometryHeap::~GeometryHeap() = default;
+
+void GeometryHeap::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize) {
+    physicalDevice_ = physicalDevice;
+    device_ = device;
+    blockSize_ = blockSize;
+    directWrite_ = hasDirectWriteMemory(physicalDevice);
+}
+
+void GeometryHeap::clean() {
+    for (uint32_t b = 0; b < blocks_.size(); ++b) {
+        if (blocks_[b].buffer) destroyBlock(b);
+    }
+
+    blocks_.clear();
+    allocations_.clear();
+}
+
+GeometryHandle GeometryHeap::upload(const void* data, VkDeviceSize size, VkDeviceSize alignment,
+                                    GpuTimeline& transferTimeline, VkCommandPool transferCommandPool) {
+    Allocation allocation{};
+    allocation.size = size;
+    allocation.alignment = alignment;
+    allocation.block = UINT32_MAX;
+
+    // First block with room, the one being emptied only as a last resort
+    for (uint32_t b = 0; b < blocks_.size() && allocation.block == UINT32_MAX; ++b) {
+        if (blocks_[b].buffer && b != defragmentSource_ && allocateFrom(b, size, alignment, &allocation.offset)) {
+            allocation.block = b;
+        }
+    }
+
+    if (allocation.block == UINT32_MAX && defragmentSource_ != UINT32_MAX &&
+        allocateFrom(defragmentSource_, size, alignment, &allocation.offset)) {
+        allocation.block = defragmentSource_;
+    }
+
+    if (allocation.block == UINT32_MAX) {
+        allocation.block = createBlock(std::max(blockSize_, size));
+        allocateFrom(allocation.block, size, alignment, &allocation.offset);
+    }
+
+    Block& block = blocks_[allocation.block];
+
+    if (directWrite_) {
+        // Coherent and persistently mapped, the first submission reading it sees the data
+        std::memcpy(static_cast<char*>(block.mapped) + allocation.offset, data, static_cast<size_t>(size));
+    } else {
+        // Temporary buffer to "stage" the data before copying it into the block
+        VkBuffer stagingBuffer{};
+        VkDeviceMemory stagingBufferMemory{};
+
+        createBuffer(physicalDevice_, device_, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                     &stagingBuffer, &stagingBufferMemory, MemoryCategory::STAGING);
+
+        void* mapped;
+        vkMapMemory(device_, stagingBufferMemory, 0, size, 0, &mapped);
+        std::memcpy(mapped, data, static_cast<size_t>(size));
+        vkUnmapMemory(device_, stagingBufferMemory);
+
+        VkCommandBuffer transferCmdBuffer = beginCmdBuffer(device_, transferCommandPool);
+
+        VkBufferCopy bufferCopyRegion{};
+        bufferCopyRegion.srcOffset = 0;
+        bufferCopyRegion.dstOffset = allocation.offset;
+        bufferCopyRegion.size = size;
+
+        vkCmdCopyBuffer(transferCmdBuffer, stagingBuffer, block.buffer, 1, &bufferCopyRegion);
+
+        endAndSubmitCmdBuffer(device_, transferCommandPool, transferTimeline, transferCmdBuffer);
+
+        vkDestroyBuffer(device_, stagingBuffer, nullptr);
+        freeMemory(device_, stagingBufferMemory);
+    }
+
+    return allocations_.insert(allocation);
+}
+
+void GeometryHeap::retire(GeometryHandle handle) {
+    Allocation* allocation = allocations_.get(handle);
+
+    if (allocation) allocation->retired = true;
+}
+
+void GeometryHeap::release(GeometryHandle handle) {
+    std::optional<Allocation> allocation = allocations_.erase(handle);
+
+    if (!allocation) return;
+
+    releaseRange({ allocation->block, allocation->offset, allocation->size });
+}
+
+void GeometryHeap::releaseRange(const GeometryRange& range) {
+    Block& block = blocks_[range.block];
+
+    VkDeviceSize offset = range.offset;
+    VkDeviceSize size = range.size;
+
+    // Merge with the free ranges right after and right before it
+    auto next = block.freeRanges.lower_bound(offset);
+
+    if (next != block.freeRanges.end() && next->first == offset + size) {
+        size += next->second;
+        next = block.freeRanges.erase(next);
+    }
+
+    if (next != block.freeRanges.begin()) {
+        auto previous = std::prev(next);
+
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            block.freeRanges.erase(previous);
+        }
+    }
+
+    block.freeRanges[offset] = size;
+    block.used -= range.size;
+    defragmentStalled_ = false;
+
+    // Nothing left in it (everything was released once no frame used it anymore), give the memory back
+    if (block.used == 0) destroyBlock(range.block);
+}
+
+VkBuffer GeometryHeap::getBuffer(GeometryHandle handle) {
+    Allocation* allocation = allocations_.get(handle);
+
+    return allocation ? blocks_[allocation->block].buffer : VK_NULL_HANDLE;
+}
+
+VkDeviceSize GeometryHeap::getOffset(GeometryHandle handle) {
+    Allocation* allocation = allocations_.get(handle);
+
+    return allocation ? allocation->offset : 0;
+}
+
+std::vector<GeometryRange> GeometryHeap::defragment(VkCommandBuffer commandBuffer, uint32_t maxMoves) {
+    std::vector<GeometryRange> vacated;
+
+    if (defragmentStalled_) return vacated;
+
+    // Emptiest block, worth emptying only when the others have room for all of it
+    uint32_t source = UINT32_MAX;
+
+    for (uint32_t b = 0; b < blocks_.size(); ++b) {
+        if (blocks_[b].buffer && (source == UINT32_MAX || blocks_[b].used < blocks_[source].used)) source = b;
+    }
+
+    VkDeviceSize otherFree = 0;
+
+    for (uint32_t b = 0; b < blocks_.size(); ++b) {
+        if (blocks_[b].buffer && b != source) otherFree += blocks_[b].size - blocks_[b].used;
+    }
+
+    if (source == UINT32_MAX || otherFree < blocks_[source].used) {
+        defragmentSource_ = UINT32_MAX;
+        return vacated;
+    }
+
+    defragmentSource_ = source;
+
+    // Copies grouped by the block they go to, one command each
+    std::map<uint32_t, std::vector<VkBufferCopy>> copies;
+
+    for (auto& allocation : allocations_) {
+        if (vacated.size() == maxMoves) break;
+        if (allocation.block != source || allocation.retired) continue;
+
+        for (uint32_t b = 0; b < blocks_.size(); ++b) {
+            VkDeviceSize offset;
+
+            if (b == source || !blocks_[b].buffer || !allocateFrom(b, allocation.size, allocation.alignment, &offset)) {
+                continue;
+            }
+
+            copies[b].push_back({ allocation.offset, offset, allocation.size });
+            vacated.push_back({ source, allocation.offset, allocation.size });
+
+            allocation.block = b;
+            allocation.offset = offset;
+            break;
+        }
+    }
+
+    if (vacated.empty()) {
+        // Free space is split into ranges too small for what is left (or only retired allocations are left)
+        defragmentSource_ = UINT32_MAX;
+        defragmentStalled_ = true;
+        return vacated;
+    }
+
+    // Destinations were free, so no frame reads them: only the draws after the copies have to wait for them
+    for (const auto& [block, regions] : copies) {
+        vkCmdCopyBuffer(commandBuffer, blocks_[source].buffer, blocks_[block].buffer,
+                        static_cast<uint32_t>(regions.size()), regions.data());
+    }
+
+    VkMemoryBarrier moveBarrier{};
+    moveBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    moveBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    moveBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         0, 1, &moveBarrier, 0, nullptr, 0, nullptr);
+
+    return vacated;
+}
+
+bool GeometryHeap::allocateFrom(uint32_t blockIndex, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset) {
+    Block& block = blocks_[blockIndex];
+
+    // First fit, what is left on either side stays free
+    for (auto range = block.freeRanges.begin(); range != block.freeRanges.end(); ++range) {
+        VkDeviceSize rangeStart = range->first;
+        VkDeviceSize rangeEnd = range->first + range->second;
+        VkDeviceSize alignedStart = (rangeStart + alignment - 1) / alignment * alignment;
+
+        if (alignedStart + size > rangeEnd) continue;
+
+        block.freeRanges.erase(range);
+
+        if (alignedStart > rangeStart) block.freeRanges[rangeStart] = alignedStart - rangeStart;
+        if (alignedStart + size < rangeEnd) block.freeRanges[alignedStart + size] = rangeEnd - (alignedStart + size);
+
+        block.used += size;
+        *offset = alignedStart;
+
+        return true;
+    }
+
+    return false;
+}
+
+uint32_t GeometryHeap::createBlock(VkDeviceSize size) {
+    uint32_t index = 0;
+
+    while (index < blocks_.size() && blocks_[index].buffer) ++index;
+
+    if (index == blocks_.size()) blocks_.emplace_back();
+
+    Block& block = blocks_[index];
+    block = {};
+    block.size = size;
+    block.freeRanges[0] = size;
+    defragmentStalled_ = false;
+
+    // Transfer source and destination for the staging copies and the defragmenter's moves
+    VkBufferUsageFlags usageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    VkMemoryPropertyFlags propertyFlags = directWrite_ ?
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT :
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    createBuffer(physicalDevice_, device_, size, usageFlags, propertyFlags, &block.buffer, &block.memory,
+                 MemoryCategory::MESH);
+
+    if (directWrite_) vkMapMemory(device_, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped);
+
+    return index;
+}
+
+void GeometryHeap::destroyBlock(uint32_t blockIndex) {
+    Block& block = blocks_[blockIndex];
+
+    if (block.mapped) vkUnmapMemory(device_, block.memory);
+
+    vkDestroyBuffer(device_, block.buffer, nullptr);
+    freeMemory(device_, block.memory);
+
+    block = {};
+
+    if (defragmentSource_ == blockIndex) defragmentSource_ = UINT32_MAX;
+}
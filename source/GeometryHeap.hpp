@@ -0,0 +1,88 @@
+#ifndef VULKAN_COURSE_GEOMETRYHEAP_HPP
+#define VULKAN_COURSE_GEOMETRYHEAP_HPP
+
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+#include "SlotMap.hpp"
+
+
+class GpuTimeline;
+
+// Vertex/index data in a geometry block, by handle so the defragmenter can move it without its users noticing
+using GeometryHandle = SlotHandle;
+
+// Space an allocation was moved out of, released once the frames that may still read it have finished
+struct GeometryRange {
+    uint32_t block{};
+    VkDeviceSize offset{};
+    VkDeviceSize size{};
+};
+
+// Sub-allocates mesh buffers from large device local blocks (vertex and index buffers at once)
+// Models loaded and unloaded for a long time leave holes in the blocks: every frame a few allocations are moved out of
+// the emptiest block into the others, and blocks are released as soon as nothing is left in them
+class GeometryHeap {
+    public:
+        GeometryHeap();
+        ~GeometryHeap();
+        void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize);
+        void clean();
+
+        // Allocates and fills: written directly where the blocks can be mapped (UMA/resizable BAR), staged otherwise
+        GeometryHandle upload(const void* data, VkDeviceSize size, VkDeviceSize alignment, GpuTimeline& transferTimeline,
+                              VkCommandPool transferCommandPool);
+
+        // Frames in flight may still draw it: the defragmenter leaves it where it is until it is released
+        void retire(GeometryHandle handle);
+
+        // Space is reused at once, no frame may use it anymore
+        void release(GeometryHandle handle);
+        void releaseRange(const GeometryRange& range);
+
+        VkBuffer getBuffer(GeometryHandle handle);
+        VkDeviceSize getOffset(GeometryHandle handle);
+
+        // Records copies of up to maxMoves allocations out of the emptiest block (visible to vertex input afterwards),
+        // returns the ranges they left, to release once the command buffer has finished
+        std::vector<GeometryRange> defragment(VkCommandBuffer commandBuffer, uint32_t maxMoves);
+
+    private:
+        struct Block {
+            VkBuffer buffer{}; // Null once released, the slot is reused by the next block
+            VkDeviceMemory memory{};
+            void* mapped{};
+            VkDeviceSize size{};
+            VkDeviceSize used{};
+            std::map<VkDeviceSize, VkDeviceSize> freeRanges; // Offset to size, neighbours merged
+        };
+
+        struct Allocation {
+            uint32_t block{};
+            VkDeviceSize offset{};
+            VkDeviceSize size{};
+            VkDeviceSize alignment{};
+            bool retired{false}; // Released once its frames have finished, moving it would free the copy's destination
+        };
+
+        bool allocateFrom(uint32_t block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset);
+        uint32_t createBlock(VkDeviceSize size);
+        void destroyBlock(uint32_t block);
+
+    private:
+        VkPhysicalDevice physicalDevice_{};
+        VkDevice device_{};
+        VkDeviceSize blockSize_{};
+        bool directWrite_{false};
+        std::vector<Block> blocks_;
+        SlotMap<Allocation> allocations_;
+        uint32_t defragmentSource_{UINT32_MAX}; // Block being emptied, new allocations go elsewhere
+        bool defragmentStalled_{false}; // The last pass moved nothing, try again once space is released or added
+};
+
+
+#endif
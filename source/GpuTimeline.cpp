@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "GpuTimeline.hpp"
+
+
+GpuTimeline::GpuTimeline() = default;
+
+GpuTimeline::~GpuTimeline() = default;
+
+void GpuTimeline::init(VkDevice device, VkQueue queue) {
+    device_ = device;
+    queue_ = queue;
+
+    VkSemaphoreTypeCreateInfo typeCreateInfo{};
+    typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeCreateInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreCreateInfo{};
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreCreateInfo.pNext = &typeCreateInfo;
+
+    if (vkCreateSemaphore(device_, &semaphoreCreateInfo, nullptr, &semaphore_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create a Timeline Semaphore");
+    }
+}
+
+void GpuTimeline::clean() {
+    vkDestroySemaphore(device_, semaphore_, nullptr);
+
+    semaphore_ = VK_NULL_HANDLE;
+    submittedValue_ = 0;
+    completedValue_ = 0;
+}
+
+uint64_t GpuTimeline::submit(const std::vector<VkCommandBuffer> &commandBuffers, VkSemaphore waitSemaphore,
+                             VkPipelineStageFlags waitStage, VkSemaphore signalSemaphore) {
+    uint64_t signalValue = submittedValue_ + 1;
+
+    // Timeline first, a binary semaphore's value is ignored
+    std::vector<VkSemaphore> signalSemaphores{ semaphore_ };
+    std::vector<uint64_t> signalValues{ signalValue };
+
+    if (signalSemaphore) {
+        signalSemaphores.push_back(signalSemaphore);
+        signalValues.push_back(0);
+    }
+
+    uint64_t waitValue = 0;
+
+    VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+    timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineSubmitInfo.waitSemaphoreValueCount = waitSemaphore ? 1 : 0;
+    timelineSubmitInfo.pWaitSemaphoreValues = &waitValue;
+    timelineSubmitInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineSubmitInfo.pSignalSemaphoreValues = signalValues.data();
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineSubmitInfo;
+    submitInfo.waitSemaphoreCount = waitSemaphore ? 1 : 0;
+    submitInfo.pWaitSemaphores = &waitSemaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    submitInfo.pCommandBuffers = commandBuffers.data();
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+    if (vkQueueSubmit(queue_, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit Command Buffers to Queue");
+    }
+
+    // Values only move forward, so a failed submission must not take one
+    submittedValue_ = signalValue;
+
+    return signalValue;
+}
+
+bool GpuTimeline::isComplete(uint64_t value) {
+    if (value <= completedValue_) return true;
+
+    return value <= getCompletedValue();
+}
+
+uint64_t GpuTimeline::getCompletedValue() {
+    vkGetSemaphoreCounterValue(device_, semaphore_, &completedValue_);
+
+    return completedValue_;
+}
+
+void GpuTimeline::wait(uint64_t value) {
+    if (isComplete(value)) return;
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &semaphore_;
+    waitInfo.pValues = &value;
+
+    if (vkWaitSemaphores(device_, &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to wait for the Timeline Semaphore");
+    }
+
+    completedValue_ = std::max(completedValue_, value);
+}
+
+uint64_t GpuTimeline::getSubmittedValue() const {
+    return submittedValue_;
+}
+
+VkQueue GpuTimeline::getQueue() const {
+    return queue_;
+}
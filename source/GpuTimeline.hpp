@@ -0,0 +1,44 @@
+#ifndef VULKAN_COURSE_GPUTIMELINE_HPP
+#define VULKAN_COURSE_GPUTIMELINE_HPP
+
+
+#include <cstdint>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+
+// Timeline semaphore of one queue, every submission signals the next value
+// Whether the GPU is done with something is a comparison of the value it was submitted with against the completed one
+class GpuTimeline {
+    public:
+        GpuTimeline();
+        ~GpuTimeline();
+        void init(VkDevice device, VkQueue queue);
+        void clean();
+
+        // Submits the command buffers and returns the value signalled once they have finished
+        // Binary semaphores are only for the swap chain (acquire/present can't use timelines)
+        uint64_t submit(const std::vector<VkCommandBuffer>& commandBuffers,
+                        VkSemaphore waitSemaphore = VK_NULL_HANDLE, VkPipelineStageFlags waitStage = 0,
+                        VkSemaphore signalSemaphore = VK_NULL_HANDLE);
+
+        // Only asks the device when the cached completed value is behind
+        bool isComplete(uint64_t value);
+        uint64_t getCompletedValue();
+        void wait(uint64_t value);
+
+        // Newest value submitted so far, anything in use now is done once it completes
+        [[nodiscard]] uint64_t getSubmittedValue() const;
+        [[nodiscard]] VkQueue getQueue() const;
+
+    private:
+        VkDevice device_{};
+        VkQueue queue_{};
+        VkSemaphore semaphore_{};
+        uint64_t submittedValue_{};
+        uint64_t completedValue_{};
+};
+
+
+#endif
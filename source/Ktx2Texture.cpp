@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "Ktx2Texture.hpp"
+
+
+// «KTX 20»\r\n\x1A\n
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+// Header + index, level index follows directly after
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct Ktx2LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header must be tightly packed");
+
+Ktx2Texture::Ktx2Texture() = default;
+
+Ktx2Texture::~Ktx2Texture() = default;
+
+bool Ktx2Texture::isKtx2(const std::vector<char> &fileData) {
+    return fileData.size() >= sizeof(Ktx2Header) && std::memcmp(fileData.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+}
+
+VkFormat Ktx2Texture::readFormat(const std::string &fileName) {
+    // Only peek at the header, used to pick between candidate files before loading one
+    std::ifstream file(fileName, std::ios::binary);
+    Ktx2Header header{};
+
+    if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(Ktx2Header))) return VK_FORMAT_UNDEFINED;
+    if (std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) return VK_FORMAT_UNDEFINED;
+
+    return static_cast<VkFormat>(header.vkFormat);
+}
+
+Ktx2Texture Ktx2Texture::load(const std::string &fileName, std::vector<char> fileData) {
+    if (!isKtx2(fileData)) throw std::runtime_error("Not a KTX2 file: " + fileName);
+
+    Ktx2Header header{};
+    std::memcpy(&header, fileData.data(), sizeof(Ktx2Header));
+
+    if (header.vkFormat == VK_FORMAT_UNDEFINED || header.supercompressionScheme != 0) {
+        throw std::runtime_error("Unsupported KTX2 encoding (Basis/supercompressed): " + fileName);
+    }
+
+    if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.pixelHeight == 0) {
+        throw std::runtime_error("Only 2D KTX2 textures are supported: " + fileName);
+    }
+
+    // levelCount of 0 asks the loader to generate mips, we only use what is in the file
+    uint32_t levelCount = std::max(header.levelCount, 1u);
+
+    if (fileData.size() < sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex)) {
+        throw std::runtime_error("Truncated KTX2 file: " + fileName);
+    }
+
+    Ktx2Texture texture;
+    texture.format_ = static_cast<VkFormat>(header.vkFormat);
+    texture.width_ = header.pixelWidth;
+    texture.height_ = header.pixelHeight;
+    texture.levels_.resize(levelCount);
+
+    // Level index is ordered from the base (largest) level down
+    for (uint32_t i = 0; i < levelCount; ++i) {
+        Ktx2LevelIndex levelIndex{};
+        std::memcpy(&levelIndex, fileData.data() + sizeof(Ktx2Header) + i * sizeof(Ktx2LevelIndex), sizeof(Ktx2LevelIndex));
+
+        if (levelIndex.byteOffset + levelIndex.byteLength > fileData.size()) {
+            throw std::runtime_error("Truncated KTX2 file: " + fileName);
+        }
+
+        texture.levels_[i] = { static_cast<size_t>(levelIndex.byteOffset), static_cast<size_t>(levelIndex.byteLength) };
+    }
+
+    texture.data_ = std::move(fileData);
+
+    return texture;
+}
+
+// Basic Data Format Descriptor for the block formats the encoder writes (BC1 RGB and BC3)
+static std::vector<uint32_t> createDataFormatDescriptor(VkFormat format) {
+    bool hasAlpha = format == VK_FORMAT_BC3_UNORM_BLOCK;
+    uint32_t sampleCount = hasAlpha ? 2 : 1;
+    uint32_t blockSize = 24 + 16 * sampleCount;
+
+    std::vector<uint32_t> dfd;
+    dfd.push_back(4 + blockSize); // dfdTotalSize
+    dfd.push_back(0); // vendorId = KHRONOS, descriptorType = BASICFORMAT
+    dfd.push_back(2 | (blockSize << 16)); // versionNumber = 1.3, descriptorBlockSize
+    dfd.push_back((hasAlpha ? 130u : 128u) | (1u << 8) | (1u << 16)); // BC3/BC1A model, BT709 primaries, linear transfer
+    dfd.push_back(3 | (3 << 8)); // 4x4 texel block (stored as dimension - 1)
+    dfd.push_back(hasAlpha ? 16 : 8); // bytesPlane0
+    dfd.push_back(0); // bytesPlane4-7
+
+    if (hasAlpha) {
+        // Alpha block in the first 64 bits
+        dfd.insert(dfd.end(), { 0u | (63u << 16) | (15u << 24), 0u, 0u, 0xFFFFFFFFu });
+    }
+
+    // Colour block
+    dfd.insert(dfd.end(), { (hasAlpha ? 64u : 0u) | (63u << 16), 0u, 0u, 0xFFFFFFFFu });
+
+    return dfd;
+}
+
+std::vector<char> Ktx2Texture::write(VkFormat format, uint32_t width, uint32_t height,
+                                     const std::vector<std::vector<uint8_t>> &levels) {
+    std::vector<uint32_t> dfd = createDataFormatDescriptor(format);
+
+    Ktx2Header header{};
+    std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat = format;
+    header.typeSize = 1; // Always 1 for block compressed formats
+    header.pixelWidth = width;
+    header.pixelHeight = height;
+    header.pixelDepth = 0;
+    header.layerCount = 0;
+    header.faceCount = 1;
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    header.supercompressionScheme = 0;
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + levels.size() * sizeof(Ktx2LevelIndex));
+    header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+    // Level data is stored smallest level first, each level aligned to the block size
+    std::vector<Ktx2LevelIndex> levelIndex(levels.size());
+    size_t offset = header.dfdByteOffset + header.dfdByteLength;
+
+    for (size_t i = levels.size(); i-- > 0;) {
+        offset = (offset + 15) & ~static_cast<size_t>(15);
+        levelIndex[i] = { offset, levels[i].size(), levels[i].size() };
+        offset += levels[i].size();
+    }
+
+    std::vector<char> fileData(offset, 0);
+    std::memcpy(fileData.data(), &header, sizeof(Ktx2Header));
+    std::memcpy(fileData.data() + sizeof(Ktx2Header), levelIndex.data(), levelIndex.size() * sizeof(Ktx2LevelIndex));
+    std::memcpy(fileData.data() + header.dfdByteOffset, dfd.data(), header.dfdByteLength);
+
+    for (size_t i = 0; i < levels.size(); ++i) {
+        std::memcpy(fileData.data() + levelIndex[i].byteOffset, levels[i].data(), levels[i].size());
+    }
+
+    return fileData;
+}
+
+VkFormat Ktx2Texture::getFormat() const {
+    return format_;
+}
+
+uint32_t Ktx2Texture::getWidth() const {
+    return width_;
+}
+
+uint32_t Ktx2Texture::getHeight() const {
+    return height_;
+}
+
+uint32_t Ktx2Texture::getLevelCount() const {
+    return static_cast<uint32_t>(levels_.size());
+}
+
+const Ktx2Level &Ktx2Texture::getLevel(uint32_t level) const {
+    return levels_[level];
+}
+
+const char *Ktx2Texture::getData() const {
+    return data_.data();
+}
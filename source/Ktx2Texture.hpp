@@ -0,0 +1,47 @@
+#ifndef VULKAN_COURSE_KTX2TEXTURE_HPP
+#define VULKAN_COURSE_KTX2TEXTURE_HPP
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+
+// Location of one mip level inside the file data
+struct Ktx2Level {
+    size_t offset;
+    size_t size;
+};
+
+// Minimal KTX2 container (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html)
+// Only single layer 2D textures without supercompression are supported, mip levels must be pre-built
+class Ktx2Texture {
+    public:
+        Ktx2Texture();
+        ~Ktx2Texture();
+        Ktx2Texture(Ktx2Texture&&) noexcept = default;
+        Ktx2Texture& operator=(Ktx2Texture&&) noexcept = default;
+        static bool isKtx2(const std::vector<char>& fileData);
+        static VkFormat readFormat(const std::string& fileName);
+        static Ktx2Texture load(const std::string& fileName, std::vector<char> fileData);
+        static std::vector<char> write(VkFormat format, uint32_t width, uint32_t height,
+                                       const std::vector<std::vector<uint8_t>>& levels);
+        [[nodiscard]] VkFormat getFormat() const;
+        [[nodiscard]] uint32_t getWidth() const;
+        [[nodiscard]] uint32_t getHeight() const;
+        [[nodiscard]] uint32_t getLevelCount() const;
+        [[nodiscard]] const Ktx2Level& getLevel(uint32_t level) const;
+        [[nodiscard]] const char* getData() const;
+
+    private:
+        VkFormat format_{VK_FORMAT_UNDEFINED};
+        uint32_t width_{};
+        uint32_t height_{};
+        std::vector<Ktx2Level> levels_;
+        std::vector<char> data_;
+};
+
+
+#endif
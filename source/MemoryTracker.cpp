@@ -0,0 +1,133 @@
+#include "MemoryTracker.hpp"
+
+#include "spdlog/spdlog.h"
+
+
+const char* getMemoryCategoryName(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::MESH: return "mesh";
+        case MemoryCategory::TEXTURE: return "texture";
+        case MemoryCategory::ATTACHMENT: return "attachment";
+        case MemoryCategory::STAGING: return "staging";
+        case MemoryCategory::UNIFORM: return "uniform";
+        default: return "unknown";
+    }
+}
+
+MemoryTracker::MemoryTracker() = default;
+
+MemoryTracker& MemoryTracker::get() {
+    static MemoryTracker tracker;
+
+    return tracker;
+}
+
+void MemoryTracker::init(VkPhysicalDevice physicalDevice, bool memoryBudget) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    physicalDevice_ = physicalDevice;
+    memoryBudget_ = memoryBudget;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties_);
+
+    stats_ = {};
+    stats_.budgetAvailable = memoryBudget;
+    stats_.heaps.resize(memoryProperties_.memoryHeapCount);
+    heapOverThreshold_.assign(memoryProperties_.memoryHeapCount, false);
+
+    for (uint32_t i = 0; i < memoryProperties_.memoryHeapCount; ++i) {
+        MemoryHeapStats& heap = stats_.heaps[i];
+        heap.size = memoryProperties_.memoryHeaps[i].size;
+        heap.deviceLocal = memoryProperties_.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+        // Without the extension, leave room for other processes and the driver (a fifth, as most allocators do)
+        heap.budget = heap.size / 5 * 4;
+    }
+}
+
+void MemoryTracker::clean() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Everything should have been freed by now
+    if (!allocations_.empty()) {
+        spdlog::warn("[Vulkan-Renderer] {} device memory allocations were never freed", allocations_.size());
+    }
+
+    allocations_.clear();
+}
+
+void MemoryTracker::recordAllocation(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType,
+                                     MemoryCategory category) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    uint32_t heap = memoryProperties_.memoryTypes[memoryType].heapIndex;
+
+    allocations_[memory] = { size, heap, category };
+
+    stats_.heaps[heap].allocated += size;
+    stats_.categories[static_cast<size_t>(category)].allocated += size;
+    ++stats_.categories[static_cast<size_t>(category)].allocationCount;
+}
+
+void MemoryTracker::recordFree(VkDeviceMemory memory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto allocation = allocations_.find(memory);
+
+    if (allocation == allocations_.end()) return;
+
+    stats_.heaps[allocation->second.heap].allocated -= allocation->second.size;
+    stats_.categories[static_cast<size_t>(allocation->second.category)].allocated -= allocation->second.size;
+    --stats_.categories[static_cast<size_t>(allocation->second.category)].allocationCount;
+
+    allocations_.erase(allocation);
+}
+
+void MemoryTracker::update() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (memoryBudget_) {
+        // Budgets change with what other processes use, so they are asked for again every frame
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 memoryProperties2{};
+        memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProperties2.pNext = &budgetProperties;
+
+        vkGetPhysicalDeviceMemoryProperties2(physicalDevice_, &memoryProperties2);
+
+        for (size_t i = 0; i < stats_.heaps.size(); ++i) {
+            stats_.heaps[i].budget = budgetProperties.heapBudget[i];
+            stats_.heaps[i].usage = budgetProperties.heapUsage[i];
+        }
+    } else {
+        for (auto& heap : stats_.heaps) {
+            heap.usage = heap.allocated;
+        }
+    }
+
+    for (size_t i = 0; i < stats_.heaps.size(); ++i) {
+        const MemoryHeapStats& heap = stats_.heaps[i];
+        bool overThreshold = heap.budget > 0 &&
+                             static_cast<double>(heap.usage) > static_cast<double>(heap.budget) * warningThreshold_;
+
+        if (overThreshold && !heapOverThreshold_[i]) {
+            spdlog::warn("[Vulkan-Renderer] Memory heap {} at {} MB of its {} MB budget ({} MB allocated by the renderer)",
+                         i, heap.usage >> 20, heap.budget >> 20, heap.allocated >> 20);
+        }
+
+        heapOverThreshold_[i] = overThreshold;
+    }
+}
+
+void MemoryTracker::setWarningThreshold(float fraction) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    warningThreshold_ = fraction;
+}
+
+MemoryStats MemoryTracker::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return stats_;
+}
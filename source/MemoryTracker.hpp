@@ -0,0 +1,85 @@
+#ifndef VULKAN_COURSE_MEMORYTRACKER_HPP
+#define VULKAN_COURSE_MEMORYTRACKER_HPP
+
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+
+// What a device memory allocation holds, every allocation is tagged with one
+enum class MemoryCategory {
+    MESH,
+    TEXTURE,
+    ATTACHMENT,
+    STAGING,
+    UNIFORM,
+    COUNT
+};
+
+const char* getMemoryCategoryName(MemoryCategory category);
+
+struct MemoryHeapStats {
+    VkDeviceSize size{};
+    VkDeviceSize budget{}; // What the process can use before things slow down or fail (VK_EXT_memory_budget, else estimated)
+    VkDeviceSize usage{}; // Whole process as the driver sees it (VK_EXT_memory_budget, else our allocations)
+    VkDeviceSize allocated{}; // Our live allocations
+    bool deviceLocal{false};
+};
+
+struct MemoryCategoryStats {
+    VkDeviceSize allocated{};
+    uint32_t allocationCount{};
+};
+
+struct MemoryStats {
+    bool budgetAvailable{false}; // Budget and usage come from the driver
+    std::vector<MemoryHeapStats> heaps;
+    std::array<MemoryCategoryStats, static_cast<size_t>(MemoryCategory::COUNT)> categories{};
+};
+
+// Live totals of every device memory allocation per heap and per category, with the heap budgets of the driver
+// One per process (allocations are made from free functions too), thread safe
+class MemoryTracker {
+    public:
+        static MemoryTracker& get();
+
+        void init(VkPhysicalDevice physicalDevice, bool memoryBudget);
+        void clean();
+
+        void recordAllocation(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType, MemoryCategory category);
+        void recordFree(VkDeviceMemory memory);
+
+        // Queries the budgets (once per frame) and warns about heaps whose usage crossed the threshold
+        void update();
+
+        // Fraction of a heap's budget that triggers the warning
+        void setWarningThreshold(float fraction);
+        [[nodiscard]] MemoryStats getStats() const;
+
+    private:
+        MemoryTracker();
+
+    private:
+        struct Allocation {
+            VkDeviceSize size;
+            uint32_t heap;
+            MemoryCategory category;
+        };
+
+        mutable std::mutex mutex_;
+        VkPhysicalDevice physicalDevice_{};
+        VkPhysicalDeviceMemoryProperties memoryProperties_{};
+        bool memoryBudget_{false};
+        std::unordered_map<VkDeviceMemory, Allocation> allocations_;
+        MemoryStats stats_;
+        std::vector<bool> heapOverThreshold_; // Warn once per crossing, not every frame
+        float warningThreshold_{0.9f};
+};
+
+
+#endif
@@ -1,16 +1,34 @@
-#include <cstring>
-
 #include "Mesh.hpp"
 
 Mesh::Mesh() = default;
 
-Mesh::Mesh(VkPhysicalDevice physicalDevice, VkDevice device, const std::vector<Vertex> &vertices,
-           VkQueue transferQueue, VkCommandPool transferCommandPool, const std::vector<uint32_t>& indices,
-           int newTextureID)
-        : vertexCount_(vertices.size()), physicalDevice_(physicalDevice), device_(device), indexCount_(indices.size()),
+Mesh::Mesh(GeometryHeap& geometryHeap, const std::vector<Vertex> &vertices, GpuTimeline& transferTimeline,
+           VkCommandPool transferCommandPool, const std::vector<uint32_t>& indices, int newTextureID)
+        : vertexCount_(vertices.size()), geometryHeap_(&geometryHeap), indexCount_(indices.size()),
         textureID(newTextureID) {
-    createVertexBuffer(vertices, transferQueue, transferCommandPool);
-    createIndexBuffer(indices, transferQueue, transferCommandPool);
+    createVertexBuffer(vertices, transferTimeline, transferCommandPool);
+    createPositionBuffer(vertices, transferTimeline, transferCommandPool);
+    createIndexBuffer(indices, transferTimeline, transferCommandPool);
+
+    // Sphere around the bounding box, used to estimate how large the mesh is on screen
+    if (!vertices.empty()) {
+        glm::vec3 minPos = vertices[0].pos;
+        glm::vec3 maxPos = vertices[0].pos;
+
+        for (const auto& vertex : vertices) {
+            minPos = glm::min(minPos, vertex.pos);
+            maxPos = glm::max(maxPos, vertex.pos);
+        }
+
+        glm::vec3 centre = (minPos + maxPos) * 0.5f;
+        float radius = 0.0f;
+
+        for (const auto& vertex : vertices) {
+            radius = std::max(radius, glm::length(vertex.pos - centre));
+        }
+
+        boundingSphere_ = glm::vec4(centre, radius);
+    }
 
     model_ = {glm::mat4(1.0f)};
 }
@@ -22,7 +40,19 @@ int Mesh::getVertexCount() const {
 }
 
 VkBuffer Mesh::getVertexBuffer() {
-    return vertexbuffer_;
+    return geometryHeap_->getBuffer(vertexAllocation_);
+}
+
+VkDeviceSize Mesh::getVertexOffset() {
+    return geometryHeap_->getOffset(vertexAllocation_);
+}
+
+VkBuffer Mesh::getPositionBuffer() {
+    return geometryHeap_->getBuffer(positionAllocation_);
+}
+
+VkDeviceSize Mesh::getPositionOffset() {
+    return geometryHeap_->getOffset(positionAllocation_);
 }
 
 int Mesh::getIndexCount() const {
@@ -30,14 +60,23 @@ int Mesh::getIndexCount() const {
 }
 
 VkBuffer Mesh::getIndexBuffer() {
-    return indexBuffer_;
+    return geometryHeap_->getBuffer(indexAllocation_);
+}
+
+VkDeviceSize Mesh::getIndexOffset() {
+    return geometryHeap_->getOffset(indexAllocation_);
+}
+
+void Mesh::retireGeometry() {
+    geometryHeap_->retire(vertexAllocation_);
+    geometryHeap_->retire(positionAllocation_);
+    geometryHeap_->retire(indexAllocation_);
 }
 
 void Mesh::clean() {
-    vkDestroyBuffer(device_, vertexbuffer_, nullptr);
-    vkFreeMemory(device_, vertexBufferMemory, nullptr);
-    vkDestroyBuffer(device_, indexBuffer_, nullptr);
-    vkFreeMemory(device_, indexBufferMemory_, nullptr);
+    geometryHeap_->release(vertexAllocation_);
+    geometryHeap_->release(positionAllocation_);
+    geometryHeap_->release(indexAllocation_);
 }
 
 const Model &Mesh::getUboModel() const {
@@ -56,67 +95,40 @@ void Mesh::setTextureId(int textureId) {
     textureID = textureId;
 }
 
-void Mesh::createVertexBuffer(const std::vector<Vertex> &vertices, VkQueue transferQueue,
+const glm::vec4 &Mesh::getBoundingSphere() const {
+    return boundingSphere_;
+}
+
+void Mesh::createVertexBuffer(const std::vector<Vertex> &vertices, GpuTimeline& transferTimeline,
                               VkCommandPool transferCommandPool) {
     // Get size of buffer needed for vertices
     VkDeviceSize bufferSize = sizeof(Vertex) * vertices.size();
 
-    // Temporary buffer to "stage" vertex data before transferring to GPU
-    VkBuffer stagingBuffer{};
-    VkDeviceMemory statingBufferMemory{};
-
-    // Create Staging Buffer and Allocate Memory to it
-    createBuffer(physicalDevice_, device_, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer,
-                 &statingBufferMemory);
+    // Written straight into device local memory on integrated GPUs/resizable BAR, staged and copied otherwise
+    vertexAllocation_ = geometryHeap_->upload(vertices.data(), bufferSize, sizeof(Vertex), transferTimeline,
+                                              transferCommandPool);
+}
 
-    // MAP MEMORY TO VERTEX BUFFER
-    void* data; // Create a pointer to a point in normal memory
-    vkMapMemory(device_, statingBufferMemory, 0, bufferSize, 0, &data); // "Map" the vertex buffer memory to that point
-    std::memcpy(data, vertices.data(), static_cast<size_t>(bufferSize)); // Copy memory from vertices to the point
-    vkUnmapMemory(device_, statingBufferMemory); // Unmap the vertex memory buffer
+void Mesh::createPositionBuffer(const std::vector<Vertex> &vertices, GpuTimeline& transferTimeline,
+                                VkCommandPool transferCommandPool) {
+    // A third of the full vertex size, the depth pre-pass fetches nothing it doesn't use
+    std::vector<glm::vec3> positions(vertices.size());
 
-    // Create buffer with TRANSFER_DST_BIT to mark as recipient of transform data (also VERTEX_BUFFER)
-    // Buffer memory is to be DEVICE_LOCAL_BIT meaning memory is on the GPU and only accessible by it and not CPU(host)
-    createBuffer(physicalDevice_, device_, bufferSize,
-                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vertexbuffer_, &vertexBufferMemory);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        positions[i] = vertices[i].pos;
+    }
 
-    // Copy staging buffer to vertex buffer on GPU
-    copyBuffer(device_, transferQueue, transferCommandPool, stagingBuffer, vertexbuffer_, bufferSize);
+    VkDeviceSize bufferSize = sizeof(glm::vec3) * positions.size();
 
-    // Clean up staging buffer parts
-    vkDestroyBuffer(device_, stagingBuffer, nullptr);
-    vkFreeMemory(device_, statingBufferMemory, nullptr);
+    positionAllocation_ = geometryHeap_->upload(positions.data(), bufferSize, sizeof(glm::vec3), transferTimeline,
+                                                transferCommandPool);
 }
 
-void Mesh::createIndexBuffer(const std::vector<uint32_t> &indices, VkQueue transferQueue,
+void Mesh::createIndexBuffer(const std::vector<uint32_t> &indices, GpuTimeline& transferTimeline,
                              VkCommandPool transferCommandPool) {
     VkDeviceSize bufferSize = sizeof(uint32_t) * indices.size();
 
-    // Temporary buffer to "stage" index data before transferring to GPU
-    VkBuffer stagingBuffer{};
-    VkDeviceMemory statingBufferMemory{};
-
-    createBuffer(physicalDevice_, device_, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 &stagingBuffer, &statingBufferMemory);
-
-    // MAP MEMORY TO INDEX BUFFER
-    void* data;
-    vkMapMemory(device_, statingBufferMemory, 0, bufferSize, 0, &data);
-    std::memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(device_, statingBufferMemory);
-
-    // Create buffer for INDEX data on GPU access only area
-    createBuffer(physicalDevice_, device_, bufferSize,
-                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &indexBuffer_, &indexBufferMemory_);
-
-    // Copy from staging buffer to GPU access buffer
-    copyBuffer(device_, transferQueue, transferCommandPool, stagingBuffer, indexBuffer_, bufferSize);
-
-    // Destroy and Release Staging Buffer resources
-    vkDestroyBuffer(device_, stagingBuffer, nullptr);
-    vkFreeMemory(device_, statingBufferMemory, nullptr);
+    // Index buffer offsets have to be a multiple of the index size
+    indexAllocation_ = geometryHeap_->upload(indices.data(), bufferSize, sizeof(uint32_t), transferTimeline,
+                                             transferCommandPool);
 }
@@ -9,6 +9,7 @@
 #include "glm/glm.hpp"
 
 #include "Utilities.hpp"
+#include "GeometryHeap.hpp"
 
 
 struct Model {
@@ -18,37 +19,44 @@ struct Model {
 class Mesh {
     public:
         Mesh();
-        Mesh(VkPhysicalDevice physicalDevice, VkDevice device, const std::vector<Vertex>& vertices,
-             VkQueue transferQueue, VkCommandPool transferCommandPool, const std::vector<uint32_t>& indices,
-             int newTextureID);
+        Mesh(GeometryHeap& geometryHeap, const std::vector<Vertex>& vertices, GpuTimeline& transferTimeline,
+             VkCommandPool transferCommandPool, const std::vector<uint32_t>& indices, int newTextureID);
         ~Mesh();
         [[nodiscard]] int getVertexCount() const;
+        // Buffers are shared geometry blocks, bound at the mesh's offset (which changes when the block is defragmented)
         VkBuffer getVertexBuffer();
+        VkDeviceSize getVertexOffset();
+        VkBuffer getPositionBuffer();
+        VkDeviceSize getPositionOffset();
+        void retireGeometry();
         void clean();
         [[nodiscard]] int getIndexCount() const;
         VkBuffer getIndexBuffer();
+        VkDeviceSize getIndexOffset();
         [[nodiscard]] const Model &getUboModel() const;
         void setUboModel(const Model &uboModel);
         [[nodiscard]] int getTextureId() const;
         void setTextureId(int textureId);
+        [[nodiscard]] const glm::vec4& getBoundingSphere() const;
 
     private:
-        void createVertexBuffer(const std::vector<Vertex>& vertices, VkQueue transferQueue,
+        void createVertexBuffer(const std::vector<Vertex>& vertices, GpuTimeline& transferTimeline,
                                 VkCommandPool transferCommandPool);
-        void createIndexBuffer(const std::vector<uint32_t>& indices, VkQueue transferQueue,
+        void createPositionBuffer(const std::vector<Vertex>& vertices, GpuTimeline& transferTimeline,
+                                  VkCommandPool transferCommandPool);
+        void createIndexBuffer(const std::vector<uint32_t>& indices, GpuTimeline& transferTimeline,
                                VkCommandPool transferCommandPool);
 
     private:
         Model model_{};
         int vertexCount_{};
-        VkBuffer vertexbuffer_{};
-        VkPhysicalDevice physicalDevice_{};
-        VkDevice device_{};
-        VkDeviceMemory vertexBufferMemory{};
+        GeometryHeap* geometryHeap_{};
+        GeometryHandle vertexAllocation_{};
+        GeometryHandle positionAllocation_{}; // Positions only (tightly packed), for the depth pre-pass
         int indexCount_{};
-        VkBuffer indexBuffer_{};
-        VkDeviceMemory indexBufferMemory_{};
+        GeometryHandle indexAllocation_{};
         int textureID{};
+        glm::vec4 boundingSphere_{}; // Centre (x, y, z) and radius (w) in model space
 };
 
 
@@ -5,7 +5,8 @@
 
 MeshModel::MeshModel() = default;
 
-MeshModel::MeshModel(std::vector<Mesh> meshList) : meshList_(std::move(meshList)), model_(1.0f) {
+MeshModel::MeshModel(std::vector<Mesh> meshList, std::string resourceKey)
+        : meshList_(std::move(meshList)), model_(1.0f), resourceKey_(std::move(resourceKey)) {
 
 }
 
@@ -31,6 +32,16 @@ void MeshModel::setModel(const glm::mat4 &model) {
     MeshModel::model_ = model;
 }
 
+const std::string &MeshModel::getResourceKey() const {
+    return resourceKey_;
+}
+
+void MeshModel::retireGeometry() {
+    for (auto& mesh : meshList_) {
+        mesh.retireGeometry();
+    }
+}
+
 void MeshModel::clean() {
     for (auto& mesh : meshList_) {
         mesh.clean();
@@ -67,27 +78,27 @@ std::vector<std::string> MeshModel::loadMaterials(const aiScene *scene) {
     return textureList;
 }
 
-std::vector<Mesh>MeshModel::LoadNode(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool commandPool,
+std::vector<Mesh>MeshModel::LoadNode(GeometryHeap& geometryHeap, GpuTimeline& timeline, VkCommandPool commandPool,
                     aiNode *node, const aiScene *scene, const std::vector<int>& matToTex) {
     std::vector<Mesh> meshList;
 
     // Go through each mesh at this node and create it, then add it to our meshList
     for (size_t i = 0; i < node->mNumMeshes; ++i) {
         meshList.push_back(
-                LoadMesh(physicalDevice, device, queue, commandPool, scene->mMeshes[node->mMeshes[i]], scene, matToTex)
+                LoadMesh(geometryHeap, timeline, commandPool, scene->mMeshes[node->mMeshes[i]], scene, matToTex)
         );
     }
 
     // Go through each node attached to this node and load it, then append their meshes to this node's mesh list
     for (size_t i = 0; i < node->mNumChildren; ++i) {
-        std::vector<Mesh> newList = LoadNode(physicalDevice, device, queue, commandPool, node->mChildren[i], scene, matToTex);
+        std::vector<Mesh> newList = LoadNode(geometryHeap, timeline, commandPool, node->mChildren[i], scene, matToTex);
         meshList.insert(meshList.end(), newList.begin(), newList.end());
     }
 
     return meshList;
 }
 
-Mesh MeshModel::LoadMesh(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool commandPool,
+Mesh MeshModel::LoadMesh(GeometryHeap& geometryHeap, GpuTimeline& timeline, VkCommandPool commandPool,
                          aiMesh *mesh, const aiScene *scene, const std::vector<int>& matToTex) {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
@@ -123,7 +134,7 @@ Mesh MeshModel::LoadMesh(VkPhysicalDevice physicalDevice, VkDevice device, VkQue
     }
 
     // Create new mesh with details and return it
-    Mesh newMesh = Mesh(physicalDevice, device, vertices, queue, commandPool, indices, matToTex[mesh->mMaterialIndex]);
+    Mesh newMesh = Mesh(geometryHeap, vertices, timeline, commandPool, indices, matToTex[mesh->mMaterialIndex]);
 
     return newMesh;
 }
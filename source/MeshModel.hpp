@@ -12,28 +12,32 @@
 
 
 class Mesh;
+class GpuTimeline;
+class GeometryHeap;
 
 class MeshModel {
 public:
     MeshModel();
-    explicit MeshModel(std::vector<Mesh> meshList);
+    explicit MeshModel(std::vector<Mesh> meshList, std::string resourceKey = "");
     ~MeshModel();
     [[nodiscard]] size_t getMeshCount() const;
     Mesh* getMesh(size_t index);
     [[nodiscard]] const glm::mat4 &getModel() const;
     void setModel(const glm::mat4 &model);
+    [[nodiscard]] const std::string &getResourceKey() const;
+    // Called when its destruction is queued, the defragmenter no longer moves its meshes
+    void retireGeometry();
     void clean();
     static std::vector<std::string> loadMaterials(const aiScene* scene);
-    static std::vector<Mesh> LoadNode(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue,
-                                      VkCommandPool commandPool, aiNode* node, const aiScene* scene,
-                                      const std::vector<int>& matToTex);
-    static Mesh LoadMesh(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue,
-                         VkCommandPool commandPool, aiMesh* mesh, const aiScene* scene,
-                         const std::vector<int>& matToTex);
+    static std::vector<Mesh> LoadNode(GeometryHeap& geometryHeap, GpuTimeline& timeline, VkCommandPool commandPool,
+                                      aiNode* node, const aiScene* scene, const std::vector<int>& matToTex);
+    static Mesh LoadMesh(GeometryHeap& geometryHeap, GpuTimeline& timeline, VkCommandPool commandPool, aiMesh* mesh,
+                         const aiScene* scene, const std::vector<int>& matToTex);
 
 private:
     std::vector<Mesh> meshList_;
     glm::mat4 model_{};
+    std::string resourceKey_;
 };
 
 
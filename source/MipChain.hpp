@@ -0,0 +1,40 @@
+#ifndef VULKAN_COURSE_MIPCHAIN_HPP
+#define VULKAN_COURSE_MIPCHAIN_HPP
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+
+// Mip chain helpers of the renderer and the offline texture encoder, kept free of any Vulkan dependency
+
+// Number of levels in a full mip chain, down to 1x1
+static uint32_t getMipLevels(uint32_t width, uint32_t height) {
+    return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+// Box filter a RGBA8 mip level into the next one (half size), edges are clamped for odd sizes
+// Kept branch free in the inner loop so the compiler can vectorise it
+static void downsampleImage(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst) {
+    uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+    uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+
+    for (uint32_t y = 0; y < dstHeight; ++y) {
+        const uint8_t* row0 = src + std::min(y * 2, srcHeight - 1) * srcWidth * 4;
+        const uint8_t* row1 = src + std::min(y * 2 + 1, srcHeight - 1) * srcWidth * 4;
+        uint8_t* dstRow = dst + y * dstWidth * 4;
+
+        for (uint32_t x = 0; x < dstWidth; ++x) {
+            uint32_t x0 = std::min(x * 2, srcWidth - 1) * 4;
+            uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1) * 4;
+
+            for (uint32_t c = 0; c < 4; ++c) {
+                dstRow[x * 4 + c] = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+            }
+        }
+    }
+}
+
+
+#endif
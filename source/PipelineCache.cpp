@@ -0,0 +1,110 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+#include "PipelineCache.hpp"
+
+
+// Header every pipeline cache blob starts with (VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+static const size_t PIPELINE_CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+PipelineCache::PipelineCache(std::string fileName) : fileName_(std::move(fileName)) {  }
+
+PipelineCache::~PipelineCache() = default;
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice device) {
+    device_ = device;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties_);
+
+    // Seed the cache with the data saved by the last run, when there is some and it was made by this device/driver
+    std::vector<char> cacheData;
+    std::ifstream file(fileName_, std::ios::binary | std::ios::ate);
+
+    if (file.is_open()) {
+        cacheData.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(cacheData.data(), static_cast<std::streamsize>(cacheData.size()));
+
+        if (!file || !isCompatible(cacheData)) {
+            spdlog::info("[Vulkan-Renderer] Ignoring pipeline cache {}, it doesn't match this device", fileName_);
+            cacheData.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheCreateInfo{};
+    cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheCreateInfo.initialDataSize = cacheData.size();
+    cacheCreateInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+    VkResult result = vkCreatePipelineCache(device_, &cacheCreateInfo, nullptr, &cache_);
+
+    if (result != VK_SUCCESS) throw std::runtime_error("Failed to create a Pipeline Cache");
+
+    spdlog::info("[Vulkan-Renderer] Pipeline cache loaded with {} bytes", cacheData.size());
+}
+
+void PipelineCache::save() {
+    if (!cache_) return;
+
+    size_t dataSize = 0;
+
+    if (vkGetPipelineCacheData(device_, cache_, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) return;
+
+    std::vector<char> cacheData(dataSize);
+
+    if (vkGetPipelineCacheData(device_, cache_, &dataSize, cacheData.data()) != VK_SUCCESS) return;
+
+    // Write next to the old file and rename over it, a crash mid-write never leaves a truncated cache behind
+    std::string tempFileName = fileName_ + ".tmp";
+
+    {
+        std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+        file.write(cacheData.data(), static_cast<std::streamsize>(dataSize));
+
+        if (!file) {
+            spdlog::info("[Vulkan-Renderer] Failed to write pipeline cache {}", tempFileName);
+            std::remove(tempFileName.c_str());
+            return;
+        }
+    }
+
+#ifdef _WIN32
+    // rename doesn't replace an existing file on Windows
+    std::remove(fileName_.c_str());
+#endif
+
+    if (std::rename(tempFileName.c_str(), fileName_.c_str()) != 0) {
+        spdlog::info("[Vulkan-Renderer] Failed to replace pipeline cache {}", fileName_);
+        std::remove(tempFileName.c_str());
+        return;
+    }
+
+    spdlog::info("[Vulkan-Renderer] Pipeline cache saved with {} bytes", dataSize);
+}
+
+void PipelineCache::clean() {
+    vkDestroyPipelineCache(device_, cache_, nullptr);
+    cache_ = VK_NULL_HANDLE;
+}
+
+VkPipelineCache PipelineCache::getCache() const {
+    return cache_;
+}
+
+bool PipelineCache::isCompatible(const std::vector<char>& cacheData) const {
+    if (cacheData.size() < PIPELINE_CACHE_HEADER_SIZE) return false;
+
+    // Header: length, version, vendor ID, device ID (4 bytes each), then the pipeline cache UUID
+    uint32_t header[4];
+    std::memcpy(header, cacheData.data(), sizeof(header));
+
+    return header[0] >= PIPELINE_CACHE_HEADER_SIZE &&
+           header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header[2] == deviceProperties_.vendorID &&
+           header[3] == deviceProperties_.deviceID &&
+           std::memcmp(cacheData.data() + sizeof(header), deviceProperties_.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,33 @@
+#ifndef VULKAN_COURSE_PIPELINECACHE_HPP
+#define VULKAN_COURSE_PIPELINECACHE_HPP
+
+
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+
+// VkPipelineCache kept on disk between runs, so pipelines compiled by an earlier launch don't have to be rebuilt
+class PipelineCache {
+    public:
+        explicit PipelineCache(std::string fileName);
+        ~PipelineCache();
+        void init(VkPhysicalDevice physicalDevice, VkDevice device);
+        void save();
+        void clean();
+        [[nodiscard]] VkPipelineCache getCache() const;
+
+    private:
+        // Data written by another driver/GPU (or a corrupt file) would be rejected or, worse, misread by the driver
+        bool isCompatible(const std::vector<char>& cacheData) const;
+
+    private:
+        std::string fileName_;
+        VkPhysicalDeviceProperties deviceProperties_{};
+        VkDevice device_{};
+        VkPipelineCache cache_{};
+};
+
+
+#endif
@@ -0,0 +1,537 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "spdlog/spdlog.h"
+
+#include "RenderGraph.hpp"
+#include "Utilities.hpp"
+
+
+// Only writes have to be made available to the next use, reads just have to happen before it (execution dependency)
+static const VkAccessFlags WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+// Adds to the dependency of the subpass pair, or creates it
+static void addDependency(std::vector<VkSubpassDependency>& dependencies, uint32_t srcSubpass, uint32_t dstSubpass,
+                          VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                          VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) {
+    auto dependency = std::find_if(dependencies.begin(), dependencies.end(), [&](const VkSubpassDependency& d) {
+        return d.srcSubpass == srcSubpass && d.dstSubpass == dstSubpass;
+    });
+
+    if (dependency == dependencies.end()) {
+        // Between subpasses every access is to the same pixel, so by region is enough
+        bool external = srcSubpass == VK_SUBPASS_EXTERNAL || dstSubpass == VK_SUBPASS_EXTERNAL;
+
+        dependencies.push_back({ srcSubpass, dstSubpass, 0, 0, 0, 0,
+                                 external ? 0u : static_cast<VkDependencyFlags>(VK_DEPENDENCY_BY_REGION_BIT) });
+        dependency = dependencies.end() - 1;
+    }
+
+    dependency->srcStageMask |= srcStages;
+    dependency->srcAccessMask |= srcAccess;
+    dependency->dstStageMask |= dstStages;
+    dependency->dstAccessMask |= dstAccess;
+}
+
+RenderGraph::RenderGraph() = default;
+
+RenderGraph::~RenderGraph() = default;
+
+RenderGraphResource RenderGraph::importSwapChain(const std::string &name, VkFormat format, VkClearValue clearValue) {
+    for (const auto& attachment : attachments_) {
+        if (attachment.swapChain) throw std::runtime_error("Render graph already has a swap chain attachment");
+    }
+
+    RenderGraphAttachment attachment{ .name = name, .format = format, .swapChain = true, .clear = true,
+                                      .clearValue = clearValue };
+    attachments_.push_back(attachment);
+
+    return static_cast<RenderGraphResource>(attachments_.size() - 1);
+}
+
+RenderGraphResource RenderGraph::createAttachment(const std::string &name, VkFormat format, bool depth,
+                                                  bool clear, VkClearValue clearValue) {
+    RenderGraphAttachment attachment{ .name = name, .format = format, .depth = depth, .clear = clear,
+                                      .clearValue = clearValue };
+    attachments_.push_back(attachment);
+
+    return static_cast<RenderGraphResource>(attachments_.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const std::string &name) {
+    passes_.push_back({ name, {} });
+
+    return static_cast<uint32_t>(passes_.size() - 1);
+}
+
+void RenderGraph::writeColour(uint32_t pass, RenderGraphResource attachment) {
+    use(pass, attachment, AttachmentUse::COLOUR_WRITE);
+}
+
+void RenderGraph::writeDepth(uint32_t pass, RenderGraphResource attachment) {
+    use(pass, attachment, AttachmentUse::DEPTH_WRITE);
+}
+
+void RenderGraph::readInput(uint32_t pass, RenderGraphResource attachment) {
+    use(pass, attachment, AttachmentUse::INPUT_READ);
+}
+
+VkRenderPass RenderGraph::compile(VkDevice device) {
+    computeLifetimes();
+    assignAliasGroups();
+
+    // ATTACHMENTS
+    std::vector<uint32_t> groupSizes(aliasGroupCount_);
+
+    for (const auto& attachment : attachments_) {
+        if (attachment.aliasGroup != UINT32_MAX) ++groupSizes[attachment.aliasGroup];
+    }
+
+    std::vector<VkAttachmentDescription> descriptions;
+
+    for (uint32_t a = 0; a < attachments_.size(); ++a) {
+        const RenderGraphAttachment& attachment = attachments_[a];
+
+        // Transient attachments live only inside the render pass, nothing is loaded or stored
+        // Their final layout is the one of their last use, so the end of the pass doesn't transition them
+        const auto& lastUses = passes_[attachment.lastPass].uses;
+        auto lastUse = std::find_if(lastUses.rbegin(), lastUses.rend(), [a](const auto& use) { return use.first == a; });
+
+        bool aliased = attachment.aliasGroup != UINT32_MAX && groupSizes[attachment.aliasGroup] > 1;
+
+        descriptions.push_back({
+            .flags = aliased ? static_cast<VkAttachmentDescriptionFlags>(VK_ATTACHMENT_DESCRIPTION_MAY_ALIAS_BIT) : 0u,
+            .format = attachment.format,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = attachment.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .storeOp = attachment.swapChain ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED, // Every attachment is cleared or written first
+            .finalLayout = attachment.swapChain ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : getLayout(attachment, lastUse->second)
+        });
+    }
+
+    // SUBPASSES
+    // References are kept per pass until the render pass is created
+    std::vector<std::vector<VkAttachmentReference>> colourReferences(passes_.size());
+    std::vector<std::vector<VkAttachmentReference>> inputReferences(passes_.size());
+    std::vector<VkAttachmentReference> depthReferences(passes_.size());
+    std::vector<std::vector<uint32_t>> preserveAttachments(passes_.size());
+    std::vector<VkSubpassDescription> subpasses(passes_.size());
+
+    for (uint32_t p = 0; p < passes_.size(); ++p) {
+        bool hasDepth = false;
+
+        for (const auto& [index, use] : passes_[p].uses) {
+            VkAttachmentReference reference{ index, getLayout(attachments_[index], use) };
+
+            switch (use) {
+                case AttachmentUse::COLOUR_WRITE:
+                    colourReferences[p].push_back(reference);
+                    break;
+                case AttachmentUse::DEPTH_WRITE:
+                    depthReferences[p] = reference;
+                    hasDepth = true;
+                    break;
+                case AttachmentUse::INPUT_READ:
+                    inputReferences[p].push_back(reference);
+                    break;
+            }
+        }
+
+        // Attachments a later pass still needs have to survive passes that don't touch them
+        for (uint32_t a = 0; a < attachments_.size(); ++a) {
+            const auto& uses = passes_[p].uses;
+            bool used = std::any_of(uses.begin(), uses.end(), [a](const auto& use) { return use.first == a; });
+
+            if (!used && attachments_[a].firstPass < p && p < attachments_[a].lastPass) preserveAttachments[p].push_back(a);
+        }
+
+        subpasses[p].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpasses[p].colorAttachmentCount = static_cast<uint32_t>(colourReferences[p].size());
+        subpasses[p].pColorAttachments = colourReferences[p].data();
+        subpasses[p].pDepthStencilAttachment = hasDepth ? &depthReferences[p] : nullptr;
+        subpasses[p].inputAttachmentCount = static_cast<uint32_t>(inputReferences[p].size());
+        subpasses[p].pInputAttachments = inputReferences[p].data();
+        subpasses[p].preserveAttachmentCount = static_cast<uint32_t>(preserveAttachments[p].size());
+        subpasses[p].pPreserveAttachments = preserveAttachments[p].data();
+    }
+
+    // SUBPASS DEPENDENCIES
+    // Follow every attachment through the passes: each use waits for the last write (read/write after write), a write
+    // also waits for the reads since that write (write after read)
+    std::vector<VkSubpassDependency> dependencies;
+
+    for (uint32_t a = 0; a < attachments_.size(); ++a) {
+        uint32_t lastWriter = UINT32_MAX;
+        AttachmentUse lastWrite{};
+        std::vector<std::pair<uint32_t, AttachmentUse>> readers;
+
+        for (uint32_t p = 0; p < passes_.size(); ++p) {
+            for (const auto& [index, use] : passes_[p].uses) {
+                if (index != a) continue;
+
+                if (p == attachments_[a].firstPass && lastWriter == UINT32_MAX && readers.empty()) {
+                    // The layout transition from UNDEFINED happens at the start of the first use
+                    // For the swap chain the source stage matches the acquire semaphore wait
+                    addDependency(dependencies, VK_SUBPASS_EXTERNAL, p, getStages(use), 0, getStages(use), getAccess(use));
+                }
+
+                if (use == AttachmentUse::INPUT_READ) {
+                    if (lastWriter != UINT32_MAX && lastWriter != p) {
+                        addDependency(dependencies, lastWriter, p, getStages(lastWrite), getAccess(lastWrite) & WRITE_ACCESS,
+                                      getStages(use), getAccess(use));
+                    }
+
+                    readers.emplace_back(p, use);
+                    continue;
+                }
+
+                if (!readers.empty()) {
+                    for (const auto& [reader, readUse] : readers) {
+                        if (reader != p) addDependency(dependencies, reader, p, getStages(readUse), 0, getStages(use), getAccess(use));
+                    }
+                } else if (lastWriter != UINT32_MAX && lastWriter != p) {
+                    addDependency(dependencies, lastWriter, p, getStages(lastWrite), getAccess(lastWrite) & WRITE_ACCESS,
+                                  getStages(use), getAccess(use));
+                }
+
+                lastWriter = p;
+                lastWrite = use;
+                readers.clear();
+            }
+        }
+
+        // Presentation waits on a semaphore, the dependency only has to cover the transition to PRESENT_SRC
+        // (and frame captures, which copy the image right after the render pass)
+        if (attachments_[a].swapChain && lastWriter != UINT32_MAX) {
+            addDependency(dependencies, lastWriter, VK_SUBPASS_EXTERNAL, getStages(lastWrite),
+                          getAccess(lastWrite) & WRITE_ACCESS, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        }
+    }
+
+    // An aliased attachment can only start once the previous user of its memory is done with it
+    for (uint32_t a = 0; a < attachments_.size(); ++a) {
+        const RenderGraphAttachment& next = attachments_[a];
+        uint32_t previous = UINT32_MAX;
+
+        for (uint32_t b = 0; b < attachments_.size(); ++b) {
+            const RenderGraphAttachment& candidate = attachments_[b];
+
+            if (b == a || next.aliasGroup == UINT32_MAX || candidate.aliasGroup != next.aliasGroup ||
+                candidate.lastPass >= next.firstPass) continue;
+
+            if (previous == UINT32_MAX || candidate.lastPass > attachments_[previous].lastPass) previous = b;
+        }
+
+        if (previous == UINT32_MAX) continue;
+
+        VkPipelineStageFlags srcStages = 0;
+        VkAccessFlags srcAccess = 0;
+
+        for (const auto& [index, use] : passes_[attachments_[previous].lastPass].uses) {
+            if (index != previous) continue;
+
+            srcStages |= getStages(use);
+            srcAccess |= getAccess(use) & WRITE_ACCESS;
+        }
+
+        for (const auto& [index, use] : passes_[next.firstPass].uses) {
+            if (index == a) {
+                addDependency(dependencies, attachments_[previous].lastPass, next.firstPass, srcStages, srcAccess,
+                              getStages(use), getAccess(use));
+            }
+        }
+    }
+
+    VkRenderPassCreateInfo renderPassCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = static_cast<uint32_t>(descriptions.size()),
+        .pAttachments = descriptions.data(),
+        .subpassCount = static_cast<uint32_t>(subpasses.size()),
+        .pSubpasses = subpasses.data(),
+        .dependencyCount = static_cast<uint32_t>(dependencies.size()),
+        .pDependencies = dependencies.data()
+    };
+
+    VkRenderPass renderPass{};
+    VkResult result = vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &renderPass);
+
+    if (result != VK_SUCCESS) throw std::runtime_error("Failed to create render pass");
+
+    spdlog::info("[Vulkan-Renderer] Render graph: {} passes, {} attachments, {} dependencies, {} memory groups",
+                 passes_.size(), attachments_.size(), dependencies.size(), aliasGroupCount_);
+
+    return renderPass;
+}
+
+RenderGraphImages RenderGraph::createImages(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent,
+                                            uint32_t frameCount) const {
+    RenderGraphImages images{};
+    images.frameCount = frameCount;
+    images.images.resize(frameCount * attachments_.size());
+    images.views.resize(frameCount * attachments_.size());
+    images.memory.resize(frameCount * aliasGroupCount_);
+
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        std::vector<VkMemoryRequirements> groupRequirements(aliasGroupCount_, { 0, 0, UINT32_MAX });
+
+        // CREATE IMAGES
+        for (uint32_t a = 0; a < attachments_.size(); ++a) {
+            const RenderGraphAttachment& attachment = attachments_[a];
+
+            if (attachment.swapChain) continue;
+
+            // Never stored, tile memory is enough where the GPU has it
+            VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | (attachment.depth ?
+                                      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+
+            for (const auto& pass : passes_) {
+                for (const auto& [index, use] : pass.uses) {
+                    if (index == a && use == AttachmentUse::INPUT_READ) usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+                }
+            }
+
+            VkImageCreateInfo imageCreateInfo{};
+            imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageCreateInfo.extent = { extent.width, extent.height, 1 };
+            imageCreateInfo.mipLevels = 1;
+            imageCreateInfo.arrayLayers = 1;
+            imageCreateInfo.format = attachment.format;
+            imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageCreateInfo.usage = usage;
+            imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            VkImage& image = images.images[frame * attachments_.size() + a];
+            VkResult result = vkCreateImage(device, &imageCreateInfo, nullptr, &image);
+
+            if (result != VK_SUCCESS) throw std::runtime_error("Failed to create a render graph attachment");
+
+            // The group's memory has to fit (and be allowed for) every image in it
+            VkMemoryRequirements memoryRequirements{};
+            vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+
+            VkMemoryRequirements& group = groupRequirements[attachment.aliasGroup];
+            group.size = std::max(group.size, memoryRequirements.size);
+            group.alignment = std::max(group.alignment, memoryRequirements.alignment);
+            group.memoryTypeBits &= memoryRequirements.memoryTypeBits;
+        }
+
+        // ALLOCATE AND BIND MEMORY, every image of a group at offset 0
+        for (uint32_t g = 0; g < aliasGroupCount_; ++g) {
+            uint32_t memoryType = findMemoryTypeIndex(physicalDevice, groupRequirements[g].memoryTypeBits,
+                                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+            // Lazily allocated memory only exists on tile based GPUs
+            if (memoryType == UINT32_MAX) {
+                memoryType = findMemoryTypeIndex(physicalDevice, groupRequirements[g].memoryTypeBits,
+                                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            }
+
+            if (memoryType == UINT32_MAX) throw std::runtime_error("No memory type for render graph attachments");
+
+            VkMemoryAllocateInfo memoryAllocateInfo{};
+            memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            memoryAllocateInfo.allocationSize = groupRequirements[g].size;
+            memoryAllocateInfo.memoryTypeIndex = memoryType;
+
+            VkResult result = vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &images.memory[frame * aliasGroupCount_ + g]);
+
+            if (result != VK_SUCCESS) throw std::runtime_error("Failed to allocate memory for render graph attachments");
+
+            MemoryTracker::get().recordAllocation(images.memory[frame * aliasGroupCount_ + g], memoryAllocateInfo.allocationSize,
+                                                  memoryType, MemoryCategory::ATTACHMENT);
+        }
+
+        for (uint32_t a = 0; a < attachments_.size(); ++a) {
+            const RenderGraphAttachment& attachment = attachments_[a];
+
+            if (attachment.swapChain) continue;
+
+            size_t index = frame * attachments_.size() + a;
+            vkBindImageMemory(device, images.images[index], images.memory[frame * aliasGroupCount_ + attachment.aliasGroup], 0);
+
+            VkImageViewCreateInfo viewCreateInfo{};
+            viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewCreateInfo.image = images.images[index];
+            viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewCreateInfo.format = attachment.format;
+            viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                                          VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+            viewCreateInfo.subresourceRange = { static_cast<VkImageAspectFlags>(attachment.depth ?
+                                                VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT), 0, 1, 0, 1 };
+
+            VkResult result = vkCreateImageView(device, &viewCreateInfo, nullptr, &images.views[index]);
+
+            if (result != VK_SUCCESS) throw std::runtime_error("Failed to create a render graph attachment view");
+        }
+    }
+
+    return images;
+}
+
+void RenderGraph::destroyImages(VkDevice device, RenderGraphImages &images) {
+    for (size_t i = 0; i < images.images.size(); ++i) {
+        if (images.views[i]) vkDestroyImageView(device, images.views[i], nullptr);
+        if (images.images[i]) vkDestroyImage(device, images.images[i], nullptr);
+    }
+
+    for (auto memory : images.memory) {
+        freeMemory(device, memory);
+    }
+
+    images = {};
+}
+
+uint32_t RenderGraph::getSubpass(uint32_t pass) const {
+    // Passes are subpasses in declaration order
+    return pass;
+}
+
+VkImageView RenderGraph::getImageView(const RenderGraphImages &images, RenderGraphResource attachment, uint32_t frame) const {
+    return images.views[frame * attachments_.size() + attachment];
+}
+
+VkImageLayout RenderGraph::getReadLayout(RenderGraphResource attachment) const {
+    return getLayout(attachments_[attachment], AttachmentUse::INPUT_READ);
+}
+
+std::vector<VkImageView> RenderGraph::getFramebufferAttachments(const RenderGraphImages &images, uint32_t frame,
+                                                                VkImageView swapChainView) const {
+    std::vector<VkImageView> views;
+
+    for (uint32_t a = 0; a < attachments_.size(); ++a) {
+        views.push_back(attachments_[a].swapChain ? swapChainView : getImageView(images, a, frame));
+    }
+
+    return views;
+}
+
+std::vector<VkClearValue> RenderGraph::getClearValues() const {
+    std::vector<VkClearValue> clearValues;
+
+    for (const auto& attachment : attachments_) {
+        clearValues.push_back(attachment.clearValue);
+    }
+
+    return clearValues;
+}
+
+void RenderGraph::use(uint32_t pass, RenderGraphResource attachment, AttachmentUse use) {
+    if (pass >= passes_.size() || attachment >= attachments_.size()) {
+        throw std::runtime_error("Render graph pass or attachment doesn't exist");
+    }
+
+    if ((use == AttachmentUse::DEPTH_WRITE) != attachments_[attachment].depth && use != AttachmentUse::INPUT_READ) {
+        throw std::runtime_error("Render graph attachment " + attachments_[attachment].name + " written as the wrong type");
+    }
+
+    passes_[pass].uses.emplace_back(attachment, use);
+}
+
+void RenderGraph::computeLifetimes() {
+    for (auto& attachment : attachments_) {
+        attachment.firstPass = UINT32_MAX;
+        attachment.lastPass = 0;
+    }
+
+    for (uint32_t p = 0; p < passes_.size(); ++p) {
+        for (const auto& [index, use] : passes_[p].uses) {
+            RenderGraphAttachment& attachment = attachments_[index];
+
+            // Nothing to read before something has been written
+            if (attachment.firstPass == UINT32_MAX && use == AttachmentUse::INPUT_READ) {
+                throw std::runtime_error("Render graph attachment " + attachment.name + " is read before it is written");
+            }
+
+            attachment.firstPass = std::min(attachment.firstPass, p);
+            attachment.lastPass = std::max(attachment.lastPass, p);
+        }
+    }
+
+    for (const auto& attachment : attachments_) {
+        if (attachment.firstPass == UINT32_MAX) throw std::runtime_error("Render graph attachment " + attachment.name + " is never used");
+    }
+}
+
+void RenderGraph::assignAliasGroups() {
+    // Greedy interval colouring: attachments in order of their first pass join the first group of the same kind
+    // (colour/depth) that is free by then
+    std::vector<uint32_t> order;
+
+    for (uint32_t a = 0; a < attachments_.size(); ++a) {
+        if (!attachments_[a].swapChain) order.push_back(a);
+    }
+
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return attachments_[a].firstPass < attachments_[b].firstPass;
+    });
+
+    struct Group {
+        bool depth;
+        uint32_t lastPass;
+    };
+
+    std::vector<Group> groups;
+
+    for (uint32_t a : order) {
+        RenderGraphAttachment& attachment = attachments_[a];
+
+        auto group = std::find_if(groups.begin(), groups.end(), [&](const Group& g) {
+            return g.depth == attachment.depth && g.lastPass < attachment.firstPass;
+        });
+
+        if (group == groups.end()) {
+            groups.push_back({ attachment.depth, 0 });
+            group = groups.end() - 1;
+        }
+
+        group->lastPass = attachment.lastPass;
+        attachment.aliasGroup = static_cast<uint32_t>(group - groups.begin());
+    }
+
+    aliasGroupCount_ = static_cast<uint32_t>(groups.size());
+}
+
+VkImageLayout RenderGraph::getLayout(const RenderGraphAttachment &attachment, AttachmentUse use) {
+    switch (use) {
+        case AttachmentUse::COLOUR_WRITE:
+            return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        case AttachmentUse::DEPTH_WRITE:
+            return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        case AttachmentUse::INPUT_READ:
+            return attachment.depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
+    return VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+VkPipelineStageFlags RenderGraph::getStages(AttachmentUse use) {
+    switch (use) {
+        case AttachmentUse::COLOUR_WRITE:
+            return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        case AttachmentUse::DEPTH_WRITE:
+            return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        case AttachmentUse::INPUT_READ:
+            return VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+
+    return 0;
+}
+
+VkAccessFlags RenderGraph::getAccess(AttachmentUse use) {
+    switch (use) {
+        case AttachmentUse::COLOUR_WRITE:
+            return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        case AttachmentUse::DEPTH_WRITE:
+            return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        case AttachmentUse::INPUT_READ:
+            return VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+    }
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#ifndef VULKAN_COURSE_RENDERGRAPH_HPP
+#define VULKAN_COURSE_RENDERGRAPH_HPP
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+
+// Attachment of the graph, by index (also its index in the render pass and framebuffer)
+using RenderGraphResource = uint32_t;
+
+// How a pass uses an attachment, decides layouts, stages and access masks
+enum class AttachmentUse {
+    COLOUR_WRITE,
+    DEPTH_WRITE,
+    INPUT_READ
+};
+
+struct RenderGraphAttachment {
+    std::string name;
+    VkFormat format{};
+    bool depth{false};
+    bool swapChain{false}; // Imported swap chain image, stored and presented after the last pass
+    bool clear{false}; // Cleared by its first pass (otherwise its contents start undefined)
+    VkClearValue clearValue{};
+    uint32_t firstPass{UINT32_MAX}; // Lifetime, filled in by compile
+    uint32_t lastPass{};
+    uint32_t aliasGroup{UINT32_MAX}; // Transient attachments sharing memory with others of the same group
+};
+
+struct RenderGraphPass {
+    std::string name;
+    std::vector<std::pair<RenderGraphResource, AttachmentUse>> uses;
+};
+
+// Images of the transient attachments for every frame in flight, memory is shared within alias groups
+struct RenderGraphImages {
+    uint32_t frameCount{};
+    std::vector<VkImage> images; // frame * attachment count + attachment, null for the swap chain
+    std::vector<VkImageView> views;
+    std::vector<VkDeviceMemory> memory; // frame * group count + group
+};
+
+// Passes declare the attachments they write and read, the graph turns them into subpasses (in declaration order) of
+// one render pass with the layouts, load/store ops and dependencies that follow from those uses
+// Transient attachments whose lifetimes don't overlap share memory
+class RenderGraph {
+    public:
+        RenderGraph();
+        ~RenderGraph();
+
+        // - Declaration
+        RenderGraphResource importSwapChain(const std::string& name, VkFormat format, VkClearValue clearValue);
+        RenderGraphResource createAttachment(const std::string& name, VkFormat format, bool depth,
+                                             bool clear, VkClearValue clearValue = {});
+        uint32_t addPass(const std::string& name);
+        void writeColour(uint32_t pass, RenderGraphResource attachment);
+        void writeDepth(uint32_t pass, RenderGraphResource attachment);
+        void readInput(uint32_t pass, RenderGraphResource attachment);
+
+        // Creates the render pass, the caller owns it
+        VkRenderPass compile(VkDevice device);
+
+        // - Attachment images
+        RenderGraphImages createImages(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent,
+                                       uint32_t frameCount) const;
+        static void destroyImages(VkDevice device, RenderGraphImages& images);
+
+        // - Recording
+        [[nodiscard]] uint32_t getSubpass(uint32_t pass) const;
+        [[nodiscard]] VkImageView getImageView(const RenderGraphImages& images, RenderGraphResource attachment,
+                                               uint32_t frame) const;
+        [[nodiscard]] VkImageLayout getReadLayout(RenderGraphResource attachment) const;
+        [[nodiscard]] std::vector<VkImageView> getFramebufferAttachments(const RenderGraphImages& images, uint32_t frame,
+                                                                         VkImageView swapChainView) const;
+        [[nodiscard]] std::vector<VkClearValue> getClearValues() const;
+
+    private:
+        void use(uint32_t pass, RenderGraphResource attachment, AttachmentUse use);
+        void computeLifetimes();
+        void assignAliasGroups();
+
+        static VkImageLayout getLayout(const RenderGraphAttachment& attachment, AttachmentUse use);
+        static VkPipelineStageFlags getStages(AttachmentUse use);
+        static VkAccessFlags getAccess(AttachmentUse use);
+
+    private:
+        std::vector<RenderGraphAttachment> attachments_;
+        std::vector<RenderGraphPass> passes_;
+        uint32_t aliasGroupCount_{};
+};
+
+
+#endif
@@ -0,0 +1,115 @@
+#include <iomanip>
+#include <sstream>
+
+#include "spdlog/spdlog.h"
+
+#include "ResourceRegistry.hpp"
+
+
+ResourceRegistry::ResourceRegistry() = default;
+
+ResourceRegistry::~ResourceRegistry() = default;
+
+std::string ResourceRegistry::makeKey(const std::string &fileName, const std::vector<char> &fileData) {
+    std::stringstream key;
+    key << fileName << ':' << std::hex << std::setw(16) << std::setfill('0') << hashData(fileData.data(), fileData.size());
+
+    return key.str();
+}
+
+uint64_t ResourceRegistry::hashData(const char *data, size_t size) {
+    // 64-bit FNV-1a, cheap compared to decoding the file and good enough to tell files apart
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+TextureResource *ResourceRegistry::acquireTexture(const std::string &key) {
+    auto it = textures_.find(key);
+
+    if (it == textures_.end()) return nullptr;
+
+    // Already on the GPU, so share it
+    it->second.refCount++;
+
+    return &it->second;
+}
+
+void ResourceRegistry::addTexture(const std::string &key, int textureImage, int descriptorSet) {
+    textures_[key] = TextureResource{
+        .textureImage = textureImage,
+        .descriptorSet = descriptorSet,
+        .refCount = 1
+    };
+}
+
+bool ResourceRegistry::releaseTexture(const std::string &key, TextureResource* released) {
+    auto it = textures_.find(key);
+
+    if (it == textures_.end()) return false;
+
+    // Only the last user frees the entry
+    if (--it->second.refCount > 0) return false;
+
+    // Caller destroys the image and descriptor it pointed to
+    if (released) *released = it->second;
+
+    textures_.erase(it);
+
+    return true;
+}
+
+GeometryResource *ResourceRegistry::acquireGeometry(const std::string &key) {
+    auto it = geometry_.find(key);
+
+    if (it == geometry_.end()) return nullptr;
+
+    it->second.refCount++;
+
+    // Textures are shared together with the geometry that uses them
+    for (const auto& textureKey : it->second.textureKeys) {
+        acquireTexture(textureKey);
+    }
+
+    spdlog::info("[Resource-Registry] Reuse {}", key);
+
+    return &it->second;
+}
+
+void ResourceRegistry::addGeometry(const std::string &key, std::vector<Mesh> meshList,
+                                   std::vector<std::string> textureKeys) {
+    geometry_[key] = GeometryResource{
+        .meshList = std::move(meshList),
+        .textureKeys = std::move(textureKeys),
+        .refCount = 1
+    };
+}
+
+bool ResourceRegistry::releaseGeometry(const std::string &key, std::vector<TextureResource>* releasedTextures) {
+    auto it = geometry_.find(key);
+
+    if (it == geometry_.end()) return false;
+
+    for (const auto& textureKey : it->second.textureKeys) {
+        TextureResource released{};
+
+        if (releaseTexture(textureKey, &released) && releasedTextures) releasedTextures->push_back(released);
+    }
+
+    if (--it->second.refCount > 0) return false;
+
+    // Caller still holds copies of the meshes and is now responsible for destroying their buffers
+    geometry_.erase(it);
+
+    return true;
+}
+
+void ResourceRegistry::clear() {
+    textures_.clear();
+    geometry_.clear();
+}
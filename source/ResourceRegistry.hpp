@@ -0,0 +1,55 @@
+#ifndef VULKAN_COURSE_RESOURCEREGISTRY_HPP
+#define VULKAN_COURSE_RESOURCEREGISTRY_HPP
+
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Mesh.hpp"
+
+
+// GPU texture shared between every material that uses the same file
+struct TextureResource {
+    int textureImage{}; // Index into the renderer texture image/view lists
+    int descriptorSet{}; // Index into the renderer sampler descriptor set list
+    uint32_t refCount{};
+};
+
+// Vertex/Index buffers (and the textures they use) shared between every model loaded from the same file
+struct GeometryResource {
+    std::vector<Mesh> meshList;
+    std::vector<std::string> textureKeys; // Textures acquired when the geometry was first loaded
+    uint32_t refCount{};
+};
+
+class ResourceRegistry {
+    public:
+        ResourceRegistry();
+        ~ResourceRegistry();
+
+        // Key made of the file path plus a hash of its contents, so a changed file is never mistaken for a cached one
+        static std::string makeKey(const std::string& fileName, const std::vector<char>& fileData);
+        static uint64_t hashData(const char* data, size_t size);
+
+        // - Textures
+        TextureResource* acquireTexture(const std::string& key);
+        void addTexture(const std::string& key, int textureImage, int descriptorSet);
+        bool releaseTexture(const std::string& key, TextureResource* released = nullptr);
+
+        // - Geometry
+        GeometryResource* acquireGeometry(const std::string& key);
+        void addGeometry(const std::string& key, std::vector<Mesh> meshList, std::vector<std::string> textureKeys);
+        // Textures whose last reference went away with the geometry are added to releasedTextures
+        bool releaseGeometry(const std::string& key, std::vector<TextureResource>* releasedTextures = nullptr);
+
+        void clear();
+
+    private:
+        std::unordered_map<std::string, TextureResource> textures_;
+        std::unordered_map<std::string, GeometryResource> geometry_;
+};
+
+
+#endif
@@ -0,0 +1,51 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "EmbeddedShaders.hpp"
+
+#include "ShaderRegistry.hpp"
+
+
+ShaderRegistry::ShaderRegistry(std::string overrideDirectory) : overrideDirectory_(std::move(overrideDirectory)) {
+    if (!overrideDirectory_.empty() && overrideDirectory_.back() != '/') overrideDirectory_ += '/';
+}
+
+ShaderRegistry::~ShaderRegistry() = default;
+
+std::vector<uint32_t> ShaderRegistry::getCode(const std::string& name) const {
+    if (hasOverrideDirectory()) {
+        std::ifstream file(overrideDirectory_ + name, std::ios::binary | std::ios::ate);
+
+        if (file.is_open()) {
+            size_t fileSize = static_cast<size_t>(file.tellg());
+
+            // Half written or not SPIR-V at all, a hot-reload retries once the compiler finished
+            if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0) {
+                throw std::runtime_error("Invalid SPIR-V " + overrideDirectory_ + name);
+            }
+
+            std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(fileSize));
+
+            return code;
+        }
+    }
+
+    for (const auto& shader : embedded_shaders::shaders) {
+        if (std::strcmp(shader.name, name.c_str()) == 0) {
+            return std::vector<uint32_t>(shader.code, shader.code + shader.wordCount);
+        }
+    }
+
+    throw std::runtime_error("Shader " + name + " isn't embedded");
+}
+
+bool ShaderRegistry::hasOverrideDirectory() const {
+    return !overrideDirectory_.empty();
+}
+
+const std::string& ShaderRegistry::getOverrideDirectory() const {
+    return overrideDirectory_;
+}
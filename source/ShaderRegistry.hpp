@@ -0,0 +1,26 @@
+#ifndef VULKAN_COURSE_SHADERREGISTRY_HPP
+#define VULKAN_COURSE_SHADERREGISTRY_HPP
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// SPIR-V looked up by file name ("shader.vert.spv"), compiled into the executable at build time
+// With an override directory (development), a copy of the shader found there wins over the embedded one
+class ShaderRegistry {
+    public:
+        explicit ShaderRegistry(std::string overrideDirectory = "");
+        ~ShaderRegistry();
+
+        [[nodiscard]] std::vector<uint32_t> getCode(const std::string& name) const;
+        [[nodiscard]] bool hasOverrideDirectory() const;
+        [[nodiscard]] const std::string& getOverrideDirectory() const;
+
+    private:
+        std::string overrideDirectory_; // Empty: only embedded shaders, no file is ever read
+};
+
+
+#endif
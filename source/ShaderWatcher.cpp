@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "spdlog/spdlog.h"
+
+#include "ShaderWatcher.hpp"
+
+
+ShaderWatcher::ShaderWatcher() = default;
+
+ShaderWatcher::~ShaderWatcher() = default;
+
+void ShaderWatcher::init(const std::string& directory) {
+#ifdef __linux__
+    // Non blocking, poll is called from the frame loop
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (inotifyFd_ < 0) {
+        spdlog::info("[Vulkan-Renderer] Shader hot-reload disabled, inotify is unavailable");
+        return;
+    }
+
+    // Close after write: the compiler finished the file, moved to: editors/tools that write a copy then rename it
+    watchFd_ = inotify_add_watch(inotifyFd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+    if (watchFd_ < 0) {
+        spdlog::info("[Vulkan-Renderer] Shader hot-reload disabled, can't watch {}", directory);
+        clean();
+        return;
+    }
+
+    spdlog::info("[Vulkan-Renderer] Watching {} for shader changes", directory);
+#endif
+}
+
+void ShaderWatcher::clean() {
+#ifdef __linux__
+    if (inotifyFd_ >= 0) close(inotifyFd_); // Also removes the watch
+
+    inotifyFd_ = -1;
+    watchFd_ = -1;
+#endif
+}
+
+std::vector<std::string> ShaderWatcher::poll() {
+    std::vector<std::string> fileNames;
+
+#ifdef __linux__
+    if (inotifyFd_ < 0) return fileNames;
+
+    // Buffer aligned for the events, big enough for many at once
+    alignas(inotify_event) char buffer[4096];
+
+    while (true) {
+        ssize_t length = read(inotifyFd_, buffer, sizeof(buffer));
+
+        // EAGAIN: nothing (more) to read
+        if (length <= 0) break;
+
+        for (char* event = buffer; event < buffer + length;) {
+            auto* inotifyEvent = reinterpret_cast<inotify_event*>(event);
+
+            if (inotifyEvent->len > 0) {
+                std::string fileName(inotifyEvent->name);
+
+                // One compile can write a file several times, only report it once
+                if (std::find(fileNames.begin(), fileNames.end(), fileName) == fileNames.end()) {
+                    fileNames.push_back(fileName);
+                }
+            }
+
+            event += sizeof(inotify_event) + inotifyEvent->len;
+        }
+    }
+#endif
+
+    return fileNames;
+}
@@ -0,0 +1,27 @@
+#ifndef VULKAN_COURSE_SHADERWATCHER_HPP
+#define VULKAN_COURSE_SHADERWATCHER_HPP
+
+
+#include <string>
+#include <vector>
+
+
+// Reports files written in the shader directory (inotify, Linux only), so pipelines can be rebuilt while running
+// Elsewhere, or when the directory can't be watched, poll never reports anything
+class ShaderWatcher {
+    public:
+        ShaderWatcher();
+        ~ShaderWatcher();
+        void init(const std::string& directory);
+        void clean();
+
+        // Names of the files written since the last poll, never blocks
+        std::vector<std::string> poll();
+
+    private:
+        int inotifyFd_{-1};
+        int watchFd_{-1};
+};
+
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef VULKAN_COURSE_SLOTMAP_HPP
+#define VULKAN_COURSE_SLOTMAP_HPP
+
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+
+// Refers to a value in a SlotMap, stays invalid once the value is erased even if its slot is reused
+struct SlotHandle {
+    uint32_t index{std::numeric_limits<uint32_t>::max()};
+    uint32_t generation{};
+
+    bool operator==(const SlotHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+// Values packed in one vector (iterated every frame) with stable, generation checked handles
+// Erasing moves the last value into the hole, so only handles are stable, never pointers/indices into the values
+template<typename T>
+class SlotMap {
+    public:
+        SlotHandle insert(T value) {
+            uint32_t slotIndex;
+
+            // Reuse a slot freed by erase, its generation was bumped so old handles don't match
+            if (!freeSlots_.empty()) {
+                slotIndex = freeSlots_.back();
+                freeSlots_.pop_back();
+            } else {
+                slotIndex = static_cast<uint32_t>(slots_.size());
+                slots_.push_back({});
+            }
+
+            slots_[slotIndex].valueIndex = static_cast<uint32_t>(values_.size());
+            values_.push_back(std::move(value));
+            valueSlots_.push_back(slotIndex);
+
+            return { slotIndex, slots_[slotIndex].generation };
+        }
+
+        T* get(SlotHandle handle) {
+            if (!contains(handle)) return nullptr;
+
+            return &values_[slots_[handle.index].valueIndex];
+        }
+
+        [[nodiscard]] bool contains(SlotHandle handle) const {
+            return handle.index < slots_.size() && slots_[handle.index].generation == handle.generation &&
+                   slots_[handle.index].valueIndex != FREE;
+        }
+
+        // Removed value, or nothing for a stale handle
+        std::optional<T> erase(SlotHandle handle) {
+            if (!contains(handle)) return std::nullopt;
+
+            Slot& slot = slots_[handle.index];
+            std::optional<T> removed(std::move(values_[slot.valueIndex]));
+
+            // Fill the hole with the last value and point its slot at the new position
+            if (slot.valueIndex != values_.size() - 1) {
+                values_[slot.valueIndex] = std::move(values_.back());
+                valueSlots_[slot.valueIndex] = valueSlots_.back();
+                slots_[valueSlots_[slot.valueIndex]].valueIndex = slot.valueIndex;
+            }
+
+            values_.pop_back();
+            valueSlots_.pop_back();
+
+            slot.valueIndex = FREE;
+            ++slot.generation;
+            freeSlots_.push_back(handle.index);
+
+            return removed;
+        }
+
+        [[nodiscard]] size_t size() const { return values_.size(); }
+        [[nodiscard]] bool empty() const { return values_.empty(); }
+
+        T& operator[](size_t valueIndex) { return values_[valueIndex]; }
+
+        // Slot (handle index) of a value, stable while the value lives, unlike its position
+        [[nodiscard]] uint32_t getSlot(size_t valueIndex) const { return valueSlots_[valueIndex]; }
+        typename std::vector<T>::iterator begin() { return values_.begin(); }
+        typename std::vector<T>::iterator end() { return values_.end(); }
+
+        void clear() {
+            // Keep the slots and their generations, handles from before the clear stay invalid
+            for (uint32_t slotIndex : valueSlots_) {
+                slots_[slotIndex].valueIndex = FREE;
+                ++slots_[slotIndex].generation;
+                freeSlots_.push_back(slotIndex);
+            }
+
+            values_.clear();
+            valueSlots_.clear();
+        }
+
+    private:
+        static constexpr uint32_t FREE = std::numeric_limits<uint32_t>::max();
+
+        struct Slot {
+            uint32_t valueIndex{FREE};
+            uint32_t generation{};
+        };
+
+        std::vector<T> values_;
+        std::vector<uint32_t> valueSlots_; // Slot of every value
+        std::vector<Slot> slots_;
+        std::vector<uint32_t> freeSlots_;
+};
+
+
+#endif
@@ -0,0 +1,199 @@
+#include <algorithm>
+
+#include "TextureStreamer.hpp"
+
+
+TextureStreamer::TextureStreamer(VkDeviceSize budget) : budget_(budget) {  }
+
+TextureStreamer::~TextureStreamer() = default;
+
+uint32_t TextureStreamer::getBaseMip(uint32_t width, uint32_t height, uint32_t levelCount, uint32_t baseSize) {
+    uint32_t mip = 0;
+
+    while (mip + 1 < levelCount && std::max(width >> (mip + 1), height >> (mip + 1)) >= baseSize) {
+        ++mip;
+    }
+
+    return mip;
+}
+
+void TextureStreamer::setBudget(VkDeviceSize budget) {
+    // Lowering the budget evicts on the next update
+    budget_ = budget;
+}
+
+VkDeviceSize TextureStreamer::getBudget() const {
+    return budget_;
+}
+
+VkDeviceSize TextureStreamer::getResidentBytes() const {
+    return committedBytes_;
+}
+
+void TextureStreamer::addTexture(int descriptorSet, const StreamedTexture &texture) {
+    StreamedTexture& streamed = textures_[descriptorSet];
+    streamed = texture;
+    streamed.pendingMip = streamed.residentMip;
+    streamed.desiredMip = streamed.baseMip;
+    streamed.lastUsedFrame = frame_;
+
+    committedBytes_ += getSize(streamed, streamed.residentMip);
+}
+
+void TextureStreamer::removeTexture(int descriptorSet) {
+    auto texture = textures_.find(descriptorSet);
+
+    if (texture == textures_.end()) return;
+
+    // Committed bytes follow the pending level, a change in flight is dropped with the texture
+    committedBytes_ -= getSize(texture->second, texture->second.pendingMip);
+    textures_.erase(texture);
+}
+
+StreamedTexture *TextureStreamer::getTexture(int descriptorSet) {
+    auto texture = textures_.find(descriptorSet);
+
+    return texture != textures_.end() ? &texture->second : nullptr;
+}
+
+void TextureStreamer::beginFrame() {
+    ++frame_;
+
+    // Textures nobody asks for this frame only need their base levels
+    for (auto& [descriptorSet, texture] : textures_) {
+        texture.desiredMip = texture.baseMip;
+    }
+}
+
+void TextureStreamer::requestMip(int descriptorSet, uint32_t mip) {
+    StreamedTexture* texture = getTexture(descriptorSet);
+
+    if (!texture) return;
+
+    // Several meshes can share a texture, the closest one decides
+    texture->desiredMip = std::min(texture->desiredMip, mip);
+    texture->lastUsedFrame = frame_;
+}
+
+std::vector<StreamRequest> TextureStreamer::update(uint32_t maxRaises) {
+    std::vector<StreamRequest> requests;
+
+    // A budget of 0 means no limit
+    bool limited = budget_ > 0;
+
+    // The budget may have been lowered since the last update
+    if (limited && committedBytes_ > budget_) evict(committedBytes_ - budget_, nullptr, &requests);
+
+    std::vector<std::pair<int, StreamedTexture*>> raises;
+
+    for (auto& [descriptorSet, texture] : textures_) {
+        if (texture.pendingMip == texture.residentMip && texture.desiredMip < texture.residentMip) {
+            raises.emplace_back(descriptorSet, &texture);
+        }
+    }
+
+    // Textures furthest from their demand first
+    std::sort(raises.begin(), raises.end(), [](const auto& a, const auto& b) {
+        return a.second->residentMip - a.second->desiredMip > b.second->residentMip - b.second->desiredMip;
+    });
+
+    uint32_t raiseCount = 0;
+
+    for (auto& [descriptorSet, texture] : raises) {
+        if (raiseCount == maxRaises) break;
+
+        // Go straight to the demanded level, or as close to it as the budget allows
+        for (uint32_t target = texture->desiredMip; target < texture->residentMip; ++target) {
+            VkDeviceSize needed = getSize(*texture, target) - getSize(*texture, texture->residentMip);
+
+            if (limited && committedBytes_ + needed > budget_ &&
+                !evict(committedBytes_ + needed - budget_, texture, &requests)) {
+                continue;
+            }
+
+            requests.push_back({ descriptorSet, target });
+            texture->pendingMip = target;
+            committedBytes_ += needed;
+            ++raiseCount;
+            break;
+        }
+    }
+
+    return requests;
+}
+
+void TextureStreamer::setResident(int descriptorSet, uint32_t mip) {
+    StreamedTexture* texture = getTexture(descriptorSet);
+
+    if (!texture) return;
+
+    // Memory was already accounted for when the change was requested
+    texture->residentMip = mip;
+    texture->pendingMip = mip;
+}
+
+void TextureStreamer::cancel(int descriptorSet) {
+    StreamedTexture* texture = getTexture(descriptorSet);
+
+    if (!texture) return;
+
+    // Undo the accounting of the request, the texture stays as it was
+    committedBytes_ += getSize(*texture, texture->residentMip);
+    committedBytes_ -= getSize(*texture, texture->pendingMip);
+    texture->pendingMip = texture->residentMip;
+}
+
+void TextureStreamer::clear() {
+    textures_.clear();
+    committedBytes_ = 0;
+}
+
+VkDeviceSize TextureStreamer::getSize(const StreamedTexture &texture, uint32_t mip) {
+    VkDeviceSize size = 0;
+
+    for (size_t i = mip; i < texture.levelSizes.size(); ++i) {
+        size += texture.levelSizes[i];
+    }
+
+    return size;
+}
+
+bool TextureStreamer::evict(VkDeviceSize bytes, const StreamedTexture *keep, std::vector<StreamRequest> *requests) {
+    struct Candidate {
+        int descriptorSet;
+        StreamedTexture* texture;
+        uint32_t targetMip;
+    };
+
+    std::vector<Candidate> candidates;
+
+    for (auto& [descriptorSet, texture] : textures_) {
+        if (&texture == keep || texture.pendingMip != texture.residentMip) continue;
+
+        // Textures in use this frame only give up the levels above their demand, unused ones drop to their base
+        uint32_t targetMip = texture.lastUsedFrame == frame_ ? texture.desiredMip : texture.baseMip;
+
+        if (targetMip > texture.residentMip) candidates.push_back({ descriptorSet, &texture, targetMip });
+    }
+
+    // Least recently used first
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.texture->lastUsedFrame < b.texture->lastUsedFrame;
+    });
+
+    VkDeviceSize freed = 0;
+
+    for (const auto& candidate : candidates) {
+        if (freed >= bytes) break;
+
+        VkDeviceSize size = getSize(*candidate.texture, candidate.texture->residentMip) -
+                            getSize(*candidate.texture, candidate.targetMip);
+
+        requests->push_back({ candidate.descriptorSet, candidate.targetMip });
+        candidate.texture->pendingMip = candidate.targetMip;
+        committedBytes_ -= size;
+        freed += size;
+    }
+
+    return freed >= bytes;
+}
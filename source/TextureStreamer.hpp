@@ -0,0 +1,75 @@
+#ifndef VULKAN_COURSE_TEXTURESTREAMER_HPP
+#define VULKAN_COURSE_TEXTURESTREAMER_HPP
+
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+
+// Residency of one streamed texture, levels [residentMip, levelSizes.size()) are on the GPU
+struct StreamedTexture {
+    int textureImage{}; // Index into the renderer texture image/view lists
+    uint32_t width{}; // Size of level 0
+    uint32_t height{};
+    std::vector<VkDeviceSize> levelSizes; // Bytes of every level of the full chain
+    uint32_t baseMip{}; // Coarsest residency, loaded up front and never evicted
+    uint32_t residentMip{};
+    uint32_t pendingMip{}; // Target of a residency change in flight, equal to residentMip when idle
+    uint32_t desiredMip{}; // Finest level asked for this frame
+    uint64_t lastUsedFrame{};
+};
+
+// Residency change the renderer has to carry out
+struct StreamRequest {
+    int descriptorSet;
+    uint32_t targetMip;
+};
+
+// Decides which texture mips should be resident: raises them towards the per frame screen-space demand and
+// evicts the least recently used ones when a raise doesn't fit the memory budget
+// Only bookkeeping, the renderer does the uploads and swaps the images
+class TextureStreamer {
+    public:
+        explicit TextureStreamer(VkDeviceSize budget = 0);
+        ~TextureStreamer();
+
+        // Coarsest level that still is at least baseSize texels on its largest side (or the last level)
+        static uint32_t getBaseMip(uint32_t width, uint32_t height, uint32_t levelCount, uint32_t baseSize);
+
+        void setBudget(VkDeviceSize budget);
+        [[nodiscard]] VkDeviceSize getBudget() const;
+        [[nodiscard]] VkDeviceSize getResidentBytes() const;
+
+        void addTexture(int descriptorSet, const StreamedTexture& texture);
+        void removeTexture(int descriptorSet);
+        StreamedTexture* getTexture(int descriptorSet);
+
+        // Demand gathering, call beginFrame then requestMip for every visible use of a texture
+        void beginFrame();
+        void requestMip(int descriptorSet, uint32_t mip);
+
+        // Changes to start this frame, at most maxRaises new uploads (evictions aren't limited)
+        std::vector<StreamRequest> update(uint32_t maxRaises);
+
+        // The renderer finished (or gave up on) a residency change
+        void setResident(int descriptorSet, uint32_t mip);
+        void cancel(int descriptorSet);
+
+        void clear();
+
+    private:
+        static VkDeviceSize getSize(const StreamedTexture& texture, uint32_t mip);
+        bool evict(VkDeviceSize bytes, const StreamedTexture* keep, std::vector<StreamRequest>* requests);
+
+    private:
+        std::unordered_map<int, StreamedTexture> textures_;
+        VkDeviceSize budget_;
+        VkDeviceSize committedBytes_{}; // Resident plus pending raises, minus pending evictions
+        uint64_t frame_{};
+};
+
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef VULKAN_COURSE_THREADPOOL_HPP
+#define VULKAN_COURSE_THREADPOOL_HPP
+
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+// Fixed set of worker threads for CPU work that shouldn't block the render thread (decoding, compiling, encoding)
+class ThreadPool {
+    public:
+        explicit ThreadPool(size_t threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Queue a task, the future holds its result (or the exception it threw)
+        template<typename Function>
+        std::future<std::invoke_result_t<Function>> submit(Function function) {
+            using Result = std::invoke_result_t<Function>;
+
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+            std::future<Result> result = task->get_future();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                tasks_.emplace([task] { (*task)(); });
+            }
+
+            condition_.notify_one();
+
+            return result;
+        }
+
+        [[nodiscard]] size_t getThreadCount() const;
+
+    private:
+        void workerLoop();
+
+    private:
+        std::vector<std::thread> workers_;
+        std::queue<std::function<void()>> tasks_;
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        bool stopping_{false};
+};
+
+
+#endif
@@ -2,15 +2,68 @@
 #define VULKAN_COURSE_UTILITIES_HPP
 
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <optional>
+#include <vector>
 
 #include "glm/glm.hpp"
 #include "vulkan/vulkan.h"
 
+#include "GpuTimeline.hpp"
+#include "MemoryTracker.hpp"
+#include "MipChain.hpp"
 
-const int MAX_FRAME_DRAWS = 2;
-const int MAX_OBJECTS = 20;
+
+// Frames the CPU may record ahead of the GPU, more overlap for more latency (runtime setting, clamped to the max)
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+// Sets in the first pool of a descriptor allocator, more pools are chained as they fill up
+const uint32_t DESCRIPTOR_POOL_SETS = 32;
+
+// Mesh buffers are sub-allocated from device local blocks of this size, the defragmenter moves at most this many of
+// them per frame to empty the sparsest block
+const VkDeviceSize GEOMETRY_BLOCK_SIZE = 32 * 1024 * 1024;
+const uint32_t GEOMETRY_MOVES_PER_FRAME = 16;
+
+// Records of the per object storage buffer before it first grows (doubles when more models are alive)
+const uint32_t OBJECT_BUFFER_INITIAL_CAPACITY = 256;
+
+// Texture streaming: levels up to this size are loaded with the texture, finer ones on demand
+const uint32_t TEXTURE_STREAMING_BASE_SIZE = 128;
+const uint32_t MAX_TEXTURE_STREAMS = 4; // Raises in flight at once
+
+// Size of the bindless texture array (clamped to the device limits)
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
+// Environment variable naming a directory of .spv files that override the embedded shaders (and are hot-reloaded)
+const char* const SHADER_OVERRIDE_VARIABLE = "VULKAN_COURSE_SHADER_DIR";
+
+// Environment variables overriding the present policy (low-latency, power-saving, uncapped) and the frame rate cap
+const char* const PRESENT_POLICY_VARIABLE = "VULKAN_COURSE_PRESENT_POLICY";
+const char* const FRAME_LIMIT_VARIABLE = "VULKAN_COURSE_FRAME_LIMIT";
+const char* const FRAMES_IN_FLIGHT_VARIABLE = "VULKAN_COURSE_FRAMES_IN_FLIGHT";
+
+// Environment variable turning the depth pre-pass off (0) or on (1)
+const char* const DEPTH_PREPASS_VARIABLE = "VULKAN_COURSE_DEPTH_PREPASS";
+
+// Environment variable setting the percentage of a heap's budget that logs a warning (90 by default)
+const char* const MEMORY_WARNING_VARIABLE = "VULKAN_COURSE_MEMORY_WARNING";
+
+// Environment variables recording every frame to a directory, as png (default) or raw files
+const char* const CAPTURE_DIRECTORY_VARIABLE = "VULKAN_COURSE_CAPTURE_DIR";
+const char* const CAPTURE_FORMAT_VARIABLE = "VULKAN_COURSE_CAPTURE_FORMAT";
+
+// Readback buffers of the frame capture, frames are skipped while all of them are being copied to or encoded
+const uint32_t CAPTURE_BUFFER_COUNT = 4;
+
+// Camera clip planes, the far one is also the range of the draw sort keys
+const float CAMERA_NEAR_PLANE = 0.1f;
+const float CAMERA_FAR_PLANE = 100.0f;
 
 const std::vector<const char *> deviceExtensions = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
@@ -48,6 +101,12 @@ struct UboViewProjection {
     glm::mat4 view;
 };
 
+// Per object record of the object storage buffer (std430), indexed by the instance index of its draws
+struct ObjectData {
+    glm::mat4 model;
+    glm::mat4 modelViewProjection; // Pre-multiplied on the CPU, only re-uploaded when the model or camera moves
+};
+
 static std::vector<char> readFile(const std::string& fileName) {
     // Open stream from given file
     // std::ios::binary tells stream to read file as binary
@@ -81,7 +140,23 @@ static uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t al
     VkPhysicalDeviceMemoryProperties memoryProperties{};
     vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
 
+    // Device local memory the CPU can map only counts in the main device local heap: integrated GPUs (UMA) and resizable
+    // BAR expose all of it that way, otherwise it is the small (256MB) BAR window, not worth it over a staging copy
+    bool directWrite = (properties & (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) ==
+                       (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    VkDeviceSize deviceLocalHeapSize = 0;
+
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i) {
+        if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            deviceLocalHeapSize = std::max(deviceLocalHeapSize, memoryProperties.memoryHeaps[i].size);
+        }
+    }
+
     for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+        if (directWrite && memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size < deviceLocalHeapSize) {
+            continue;
+        }
+
         // Index of memory flags types must be match corresponding bit in allowTypes
         // Desired property bit flags are part of memory type's property flags
         if ((allowedTypes & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
@@ -95,7 +170,7 @@ static uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t al
 
 static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize bufferSize,
                          VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer* buffer,
-                         VkDeviceMemory* bufferMemory) {
+                         VkDeviceMemory* bufferMemory, MemoryCategory category) {
     // CREATE VERTEX BUFFER
     // Information to create a buffer (doesn't include assigment memory)
     VkBufferCreateInfo bufferCreateInfo{
@@ -125,6 +200,17 @@ static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDev
             .memoryTypeIndex = findMemoryTypeIndex(physicalDevice, memoryRequirements.memoryTypeBits, propertyFlags)
     };
 
+    // Device local is a preference (resizable BAR writes, GPU only buffers), any other type that fits still works
+    if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX && (propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+        memoryAllocateInfo.memoryTypeIndex = findMemoryTypeIndex(physicalDevice, memoryRequirements.memoryTypeBits,
+                                                                 propertyFlags & ~VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX) {
+        vkDestroyBuffer(device, *buffer, nullptr);
+        throw std::runtime_error("No memory type for buffer");
+    }
+
     // Allocate memory to VkDeviceMemory
     result = vkAllocateMemory(device, &memoryAllocateInfo, nullptr, bufferMemory);
 
@@ -132,10 +218,32 @@ static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDev
         throw std::runtime_error("Failed to allocate Vertex Buffer Memory");
     }
 
+    MemoryTracker::get().recordAllocation(*bufferMemory, memoryAllocateInfo.allocationSize,
+                                          memoryAllocateInfo.memoryTypeIndex, category);
+
     // Allocate memory to given vertex buffer
     vkBindBufferMemory(device, *buffer, *bufferMemory, 0);
 }
 
+// Every device memory allocation is tracked, so they are all freed through here
+static void freeMemory(VkDevice device, VkDeviceMemory memory) {
+    MemoryTracker::get().recordFree(memory);
+    vkFreeMemory(device, memory, nullptr);
+}
+
+// Integrated GPUs and resizable BAR: device local memory the CPU writes to directly, no staging copy needed
+static bool hasDirectWriteMemory(VkPhysicalDevice physicalDevice) {
+    return findMemoryTypeIndex(physicalDevice, UINT32_MAX, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != UINT32_MAX;
+}
+
+// Memory for buffers the CPU writes and the GPU reads every frame, device local where the CPU can map it
+static VkMemoryPropertyFlags getHostWriteMemoryFlags(VkPhysicalDevice physicalDevice) {
+    VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    return hasDirectWriteMemory(physicalDevice) ? flags | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : flags;
+}
+
 static VkCommandBuffer beginCmdBuffer(VkDevice device, VkCommandPool commandPool) {
     // Command buffer to hold transfer commands
     VkCommandBuffer commandBuffer{};
@@ -161,26 +269,19 @@ static VkCommandBuffer beginCmdBuffer(VkDevice device, VkCommandPool commandPool
     return commandBuffer;
 }
 
-static void endAndSubmitCmdBuffer(VkDevice device, VkCommandPool commandPool, VkQueue queue,
+static void endAndSubmitCmdBuffer(VkDevice device, VkCommandPool commandPool, GpuTimeline& timeline,
                                   VkCommandBuffer commandBuffer) {
     // End Commands
     vkEndCommandBuffer(commandBuffer);
 
-    // Queue submission information
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    // Submit transfer command to transfer queue and wait until it finishes
-    vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(queue);
+    // Submit transfer command to the queue and wait until it finishes (but not for the frames in flight)
+    timeline.wait(timeline.submit({ commandBuffer }));
 
     // Free temporary command buffer back to pool
     vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
-static void copyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, VkBuffer srcBuffer,
+static void copyBuffer(VkDevice device, GpuTimeline& transferTimeline, VkCommandPool transferCommandPool, VkBuffer srcBuffer,
                      VkBuffer dstBuffer, VkDeviceSize bufferSize) {
     // Create Buffer
     VkCommandBuffer transferCmdBuffer = beginCmdBuffer(device, transferCommandPool);
@@ -194,14 +295,23 @@ static void copyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool tra
     // Command to copy src buffer to dst buffer
     vkCmdCopyBuffer(transferCmdBuffer, srcBuffer, dstBuffer, 1, &bufferCopyRegion);
 
-    endAndSubmitCmdBuffer(device, transferCommandPool, transferQueue, transferCmdBuffer);
+    endAndSubmitCmdBuffer(device, transferCommandPool, transferTimeline, transferCmdBuffer);
 }
 
-static void copyImageBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
-                            VkBuffer srcBuffer, VkImage image, uint32_t width, uint32_t height) {
+static void copyImageBuffer(VkDevice device, GpuTimeline& transferTimeline, VkCommandPool transferCommandPool,
+                            VkBuffer srcBuffer, VkImage image, const std::vector<VkBufferImageCopy>& imageRegions) {
     // Create Buffer
     VkCommandBuffer transferCmdBuffer = beginCmdBuffer(device, transferCommandPool);
 
+    // Copy buffer to given image (one region per mip level present in the buffer)
+    vkCmdCopyBufferToImage(transferCmdBuffer, srcBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(imageRegions.size()), imageRegions.data());
+
+    endAndSubmitCmdBuffer(device, transferCommandPool, transferTimeline, transferCmdBuffer);
+}
+
+static void copyImageBuffer(VkDevice device, GpuTimeline& transferTimeline, VkCommandPool transferCommandPool,
+                            VkBuffer srcBuffer, VkImage image, uint32_t width, uint32_t height) {
     VkBufferImageCopy imageRegion{};
     imageRegion.bufferOffset = 0; // Offset into data
     imageRegion.bufferRowLength = 0; // Row length of data to calculate data spacing
@@ -213,16 +323,58 @@ static void copyImageBuffer(VkDevice device, VkQueue transferQueue, VkCommandPoo
     imageRegion.imageOffset = { 0, 0, 0 }; // Offset into image (as opposed to raw data in bufferOffset)
     imageRegion.imageExtent = { width, height, 1 }; // Size of region to copy as (x, y, z) values
 
-    // Copy buffer to given image
-    vkCmdCopyBufferToImage(transferCmdBuffer, srcBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageRegion);
+    copyImageBuffer(device, transferTimeline, transferCommandPool, srcBuffer, image, { imageRegion });
+}
 
-    endAndSubmitCmdBuffer(device, transferCommandPool, transferQueue, transferCmdBuffer);
+// Stages and accesses an image in the given layout is used with, the two sides of a layout transition barrier
+static void getLayoutStageAccess(VkImageLayout layout, VkPipelineStageFlags* stages, VkAccessFlags* access) {
+    switch (layout) {
+        case VK_IMAGE_LAYOUT_UNDEFINED: // Contents are discarded, nothing to wait for
+            *stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            *access = 0;
+            break;
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+            *stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            *access = VK_ACCESS_TRANSFER_WRITE_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+            *stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            *access = VK_ACCESS_TRANSFER_READ_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+            *stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            *access = VK_ACCESS_SHADER_READ_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+            *stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            *access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+            *stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            *access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+            *stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            *access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: // Presentation waits on a semaphore
+            *stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            *access = 0;
+            break;
+        default: // Anything else waits for everything
+            *stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            *access = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+            break;
+    }
 }
 
-static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool, VkImage image,
-                                  VkImageLayout oldLayout, VkImageLayout newLayout) {
-    // Create Buffer
-    VkCommandBuffer cmdBuffer = beginCmdBuffer(device, commandPool);
+// Record the barrier only, so several uploads can share one command buffer
+static void recordImageLayoutTransition(VkCommandBuffer cmdBuffer, VkImage image, VkImageLayout oldLayout,
+                                        VkImageLayout newLayout, uint32_t mipLevels) {
+    bool depth = oldLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL ||
+                 oldLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL ||
+                 newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL ||
+                 newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
     VkImageMemoryBarrier imageMemoryBarrier{};
     imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -231,31 +383,21 @@ static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool
     imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; // Queue family to transition from
     imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; // Queue family to transition to
     imageMemoryBarrier.image = image; // Image being accessed and modified as part of barrier
-    imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; // Aspect of image being altered
+    imageMemoryBarrier.subresourceRange.aspectMask = depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT; // Aspect of image being altered
     imageMemoryBarrier.subresourceRange.baseMipLevel = 0; // First mip level to start altering on
-    imageMemoryBarrier.subresourceRange.levelCount = 1; // Number of mip levels to later starting from baseMipLevel
+    imageMemoryBarrier.subresourceRange.levelCount = mipLevels; // Number of mip levels to later starting from baseMipLevel
     imageMemoryBarrier.subresourceRange.baseArrayLayer = 0; // First layer to start alterations on
     imageMemoryBarrier.subresourceRange.layerCount = 1; // Number of layers to alter starting from baseArrayLayer
 
+    // Transition must happen after the accesses of the old layout and before the ones of the new layout
     VkPipelineStageFlags srcStage;
     VkPipelineStageFlags dstStage;
+    getLayoutStageAccess(oldLayout, &srcStage, &imageMemoryBarrier.srcAccessMask);
+    getLayoutStageAccess(newLayout, &dstStage, &imageMemoryBarrier.dstAccessMask);
 
-    // If transitioning from new image to image ready to receive data...
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        imageMemoryBarrier.srcAccessMask = 0;								// Memory access stage transition must after...
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;		// Memory access stage transition must before...
-
-        srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    }
-        // If transitioning from transfer destination to shader readable...
-    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    }
+    // Only writes have to be made available
+    imageMemoryBarrier.srcAccessMask &= VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
 
     vkCmdPipelineBarrier(
             cmdBuffer,
@@ -265,8 +407,48 @@ static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool
             0, nullptr, // Buffer Memory Barrier count + data
             1, &imageMemoryBarrier // Image Memory Barrier count + data
             );
+}
+
+static void transitionImageLayout(VkDevice device, GpuTimeline& timeline, VkCommandPool commandPool, VkImage image,
+                                  VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
+    // Create Buffer
+    VkCommandBuffer cmdBuffer = beginCmdBuffer(device, commandPool);
+
+    recordImageLayoutTransition(cmdBuffer, image, oldLayout, newLayout, mipLevels);
+
+    endAndSubmitCmdBuffer(device, commandPool, timeline, cmdBuffer);
+}
+
+// Sorts keys by their upper 32 bits (the lower ones carry a payload, e.g. a draw index), stable LSD radix sort on bytes
+// Bytes every key has in common are skipped, so short (quantized) sort keys only pay for the passes they need
+static void radixSortKeys(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch) {
+    scratch.resize(keys.size());
+
+    for (uint32_t shift = 32; shift < 64; shift += 8) {
+        std::array<size_t, 256> offsets{};
+
+        for (uint64_t key : keys) {
+            ++offsets[(key >> shift) & 0xFF];
+        }
+
+        // All keys in one bucket: this byte doesn't change the order
+        if (std::find(offsets.begin(), offsets.end(), keys.size()) != offsets.end()) continue;
+
+        // Bucket counts to bucket start offsets
+        size_t offset = 0;
+
+        for (auto& bucket : offsets) {
+            size_t count = bucket;
+            bucket = offset;
+            offset += count;
+        }
+
+        for (uint64_t key : keys) {
+            scratch[offsets[(key >> shift) & 0xFF]++] = key;
+        }
 
-    endAndSubmitCmdBuffer(device, commandPool, queue, cmdBuffer);
+        keys.swap(scratch);
+    }
 }
 
 #endif
@@ -1,6 +1,12 @@
 #include <set>
 #include <algorithm>
 #include <array>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <map>
+#include <unordered_map>
 #include <malloc.h>
 
 #include "spdlog/spdlog.h"
@@ -15,8 +21,42 @@
 #include "Utilities.hpp"
 #include "ValidationLayers.hpp"
 #include "MeshModel.hpp"
+#include "Ktx2Texture.hpp"
+
+VulkanRenderer::VulkanRenderer(std::unique_ptr<Window> &window)
+    : window_(window),
+      shaderRegistry(std::getenv(SHADER_OVERRIDE_VARIABLE) ? std::getenv(SHADER_OVERRIDE_VARIABLE) : "") {
+    if (const char* policy = std::getenv(PRESENT_POLICY_VARIABLE)) {
+        std::string name = policy;
+
+        if (name == "low-latency") presentPolicy = PresentPolicy::LOW_LATENCY;
+        else if (name == "power-saving") presentPolicy = PresentPolicy::POWER_SAVING;
+        else if (name == "uncapped") presentPolicy = PresentPolicy::UNCAPPED;
+        else spdlog::warn("[Vulkan-Renderer] Unknown present policy {}, using low-latency", name);
+    }
+
+    if (const char* frameLimit = std::getenv(FRAME_LIMIT_VARIABLE)) {
+        frameLimiter.setMaxFps(std::atof(frameLimit));
+    }
+
+    if (const char* frameCount = std::getenv(FRAMES_IN_FLIGHT_VARIABLE)) {
+        setFramesInFlight(static_cast<uint32_t>(std::atoi(frameCount)));
+    }
+
+    if (const char* prePass = std::getenv(DEPTH_PREPASS_VARIABLE)) {
+        setDepthPrePass(std::atoi(prePass) != 0);
+    }
+
+    if (const char* threshold = std::getenv(MEMORY_WARNING_VARIABLE)) {
+        setMemoryWarningThreshold(static_cast<float>(std::atof(threshold)) / 100.0f);
+    }
+
+    if (const char* directory = std::getenv(CAPTURE_DIRECTORY_VARIABLE)) {
+        const char* format = std::getenv(CAPTURE_FORMAT_VARIABLE);
 
-VulkanRenderer::VulkanRenderer(std::unique_ptr<Window> &window) : window_(window) {  }
+        setCaptureRecording(directory, format && std::string(format) == "raw" ? CaptureFormat::RAW : CaptureFormat::PNG);
+    }
+}
 
 VulkanRenderer::~VulkanRenderer() = default;
 
@@ -30,28 +70,42 @@ int VulkanRenderer::init() {
         createRenderPass();
         createDescriptorSetLayout();
         createPushConstantRange();
+        pipelineCache.init(device_.physicalDevice, device_.logicalDevice);
         createGraphicsPipeline();
-        createColourBufferImage();
-        createDepthBufferImage();
+        createAttachmentImages();
         createFramebuffers();
         createCommandPool();
-        createCommandBuffers();
+        geometryHeap.init(device_.physicalDevice, device_.logicalDevice, GEOMETRY_BLOCK_SIZE);
+        frameCapture.init(device_.physicalDevice, device_.logicalDevice, CAPTURE_BUFFER_COUNT);
         createTextureSampler();
 //        allocateDynamicBufferTransferSpace();
-        createUniformBuffers();
         createDescriptorPool();
+        createFrameContexts();
+        createObjectBuffers(OBJECT_BUFFER_INITIAL_CAPACITY);
         createDescriptorSets();
-        createInputDescriptorSets();
-        createSynchronisation();
 
-        uboViewProjection.projection = glm::perspective(glm::radians(45.0f),
-                                                        static_cast<float>(swapChainExtent_.width) / static_cast<float>(swapChainExtent_.height),
-                                                        0.1f, 100.0f);
+        updateProjection();
 
         uboViewProjection.view = glm::lookAt(glm::vec3(10.0f, 0.0f, 20.0f), glm::vec3(0.0f, 0.0f, -2.0f),
                                              glm::vec3(0.0f, 1.0f, 0.0f));
 
-        uboViewProjection.projection[1][1] *= -1;
+        // Default texture budget: half of the largest device local heap, the rest is left for attachments and buffers
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(device_.physicalDevice, &memoryProperties);
+
+        VkDeviceSize deviceLocalSize = 0;
+
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i) {
+            if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                deviceLocalSize = std::max(deviceLocalSize, memoryProperties.memoryHeaps[i].size);
+            }
+        }
+
+        textureStreamer.setBudget(deviceLocalSize / 2);
+
+        if (hasDirectWriteMemory(device_.physicalDevice)) {
+            spdlog::info("[Vulkan-Renderer] Device local memory is host visible, buffers are written without staging");
+        }
 
         // Create our default "no texture" texture
         createTexture("plain.png");
@@ -65,64 +119,104 @@ int VulkanRenderer::init() {
 }
 
 void VulkanRenderer::draw() {
+    // Hold the frame back when it is capped
+    frameLimiter.wait();
+
+    FrameContext& frame = frames[currentFrame];
+
     // -- GET NEXT IMAGE --
     // Wait for given fence to signal (open) from last draw before continuing
-    vkWaitForFences(device_.logicalDevice, 1, &drawFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+    graphicsTimeline.wait(frame.timelineValue);
+
+    // Swap in finished texture residency changes and start new ones from this frame's demand
+    updateTextureStreaming();
+
+    // Encode the captures whose copies have landed
+    frameCapture.update(graphicsTimeline, threadPool);
+
+    // Command buffer and sets recorded for this frame the last time around are no longer in use
+    vkResetCommandPool(device_.logicalDevice, frame.commandPool, 0);
+    frame.descriptorAllocator.reset();
+
+    // So is the geometry its copies moved out of
+    for (const auto& range : frame.vacatedGeometry) {
+        geometryHeap.releaseRange(range);
+    }
+
+    frame.vacatedGeometry.clear();
+
+    // Swap in rebuilt pipelines
+    updatePipelines();
+
+    // Destroy what no frame in flight uses anymore (replaced pipelines and swap chains, unloaded models and textures)
+    deletionQueue.flush(graphicsTimeline.getCompletedValue());
+
+    // Budgets of this frame, after what was freed
+    MemoryTracker::get().update();
+
+    if (window_->framebufferResized_) {
+        window_->framebufferResized_ = false;
+        swapChainOutOfDate = true;
+    }
 
-    // Manually reset (close) fences
-    vkResetFences(device_.logicalDevice, 1, &drawFences[currentFrame]);
+    // Rebuild the swap chain before drawing, nothing is drawn while the window is minimised
+    if (swapChainOutOfDate || surfaceLost) {
+        recreateSwapChain();
+
+        if (swapChainOutOfDate) return;
+    }
 
     // Get index of next image to be drawn to, and signal semaphore when ready to be drawn to
     uint32_t imageIndex;
 
-    vkAcquireNextImageKHR(device_.logicalDevice, swapChain_, std::numeric_limits<uint64_t>::max(),
-                          imageAvailable[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult acquireResult = vkAcquireNextImageKHR(device_.logicalDevice, swapChain_, std::numeric_limits<uint64_t>::max(),
+                                                   frame.imageAvailable, VK_NULL_HANDLE, &imageIndex);
 
-    recordCommands(imageIndex);
-    updateUniformBuffers(imageIndex);
+    // Nothing was acquired (and the semaphore isn't signalled), try again with a new swap chain next frame
+    if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR || acquireResult == VK_ERROR_SURFACE_LOST_KHR) {
+        swapChainOutOfDate = true;
+        surfaceLost = acquireResult == VK_ERROR_SURFACE_LOST_KHR;
+        return;
+    }
 
-    // -- SUBMIT COMMAND BUFFER TO RENDER --
-    // Queue submission information
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;										// Number of semaphores to wait on
-    submitInfo.pWaitSemaphores = &imageAvailable[currentFrame];				// List of semaphores to wait on
-
-    VkPipelineStageFlags waitStages[] = {
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-    };
+    // Suboptimal still acquired an image, draw it and rebuild after presenting
+    if (acquireResult == VK_SUBOPTIMAL_KHR) swapChainOutOfDate = true;
 
-    submitInfo.pWaitDstStageMask = waitStages;						// Stages to check semaphores at
-    submitInfo.commandBufferCount = 1;								// Number of command buffers to submit
-    submitInfo.pCommandBuffers = &commandBuffers_[imageIndex];		// Command buffer to submit
-    submitInfo.signalSemaphoreCount = 1;							// Number of semaphores to signal
-    submitInfo.pSignalSemaphores = &renderFinished[currentFrame];	// Semaphores to signal when command buffer finishes
+    if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR) {
+        throw std::runtime_error("Failed to acquire a Swapchain Image");
+    }
 
-    // Submit command buffer to queue
-    VkResult result = vkQueueSubmit(graphicsQueues_, 1, &submitInfo, drawFences[currentFrame]);
+    recordCommands(frame, imageIndex);
+    updateUniformBuffers(frame);
 
-    if (result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to submit Command Buffer to Queue");
-    }
+    // -- SUBMIT COMMAND BUFFER TO RENDER --
+    // Wait for the image to be available before writing colour to it, signal the present semaphore and the timeline
+    frame.timelineValue = graphicsTimeline.submit({ frame.commandBuffer }, frame.imageAvailable,
+                                                  VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, frame.renderFinished);
+    frameCapture.setSubmitted(frame.timelineValue);
 
     // -- PRESENT RENDERED IMAGE TO SCREEN --
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;										// Number of semaphores to wait on
-    presentInfo.pWaitSemaphores = &renderFinished[currentFrame];			// Semaphores to wait on
+    presentInfo.pWaitSemaphores = &frame.renderFinished;					// Semaphores to wait on
     presentInfo.swapchainCount = 1;											// Number of swapchains to present to
     presentInfo.pSwapchains = &swapChain_;									// Swapchains to present images to
     presentInfo.pImageIndices = &imageIndex;								// Index of images in swapchains to present
 
     // Present image
-    result = vkQueuePresentKHR(presentationQueue_, &presentInfo);
+    VkResult result = vkQueuePresentKHR(presentationQueue_, &presentInfo);
 
-    if (result != VK_SUCCESS) {
+    // The swap chain no longer matches the surface, rebuild it before the next frame
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_SURFACE_LOST_KHR) {
+        swapChainOutOfDate = true;
+        surfaceLost = result == VK_ERROR_SURFACE_LOST_KHR;
+    } else if (result != VK_SUCCESS) {
         throw std::runtime_error("Failed to present Image!");
     }
 
-    // Get next frame (use % swapChainImages.size() to keep value below swapChainImages.size())
-    currentFrame = (currentFrame + 1) % MAX_FRAME_DRAWS;
+    // Get next frame (use % framesInFlight to keep value below framesInFlight)
+    currentFrame = (currentFrame + 1) % framesInFlight;
 }
 
 void VulkanRenderer::clean() {
@@ -131,16 +225,36 @@ void VulkanRenderer::clean() {
     // Wait until no actions being run on device before destroying
     vkDeviceWaitIdle(device_.logicalDevice);
 
+    // Nothing is in flight anymore, deferred destruction can run now
+    deletionQueue.flushAll();
+
 //    std::free(modelTransferSpace);
 
+    // Shared geometry is only destroyed by the last model using it
     for (auto & model : modelList) {
-        model.clean();
+        if (model.getResourceKey().empty() || resourceRegistry.releaseGeometry(model.getResourceKey())) {
+            model.clean();
+        }
+    }
+
+    resourceRegistry.clear();
+
+    // Streams still decoding write into their staging memory, so wait for the workers first
+    for (auto& stream : textureStreams) {
+        if (stream.decode.valid()) stream.decode.wait();
+        if (stream.image) vkDestroyImage(device_.logicalDevice, stream.image, nullptr);
+        if (stream.imageMemory) freeMemory(device_.logicalDevice, stream.imageMemory);
+
+        releaseTextureUpload(stream.upload);
     }
 
-    vkDestroyDescriptorPool(device_.logicalDevice, inputDescriptorPool, nullptr);
+    textureStreams.clear();
+    textureSources.clear();
+    textureStreamer.clear();
+
     vkDestroyDescriptorSetLayout(device_.logicalDevice, inputSetLayout, nullptr);
 
-    vkDestroyDescriptorPool(device_.logicalDevice, samplerDescriptorPool, nullptr);
+    if (samplerDescriptorPool) vkDestroyDescriptorPool(device_.logicalDevice, samplerDescriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(device_.logicalDevice, samplerSetLayout, nullptr);
 
     vkDestroySampler(device_.logicalDevice, textureSampler, nullptr);
@@ -148,47 +262,62 @@ void VulkanRenderer::clean() {
     for (size_t i = 0; i < textureImages.size(); ++i) {
         vkDestroyImageView(device_.logicalDevice, textureImageViews[i], nullptr);
         vkDestroyImage(device_.logicalDevice, textureImages[i], nullptr);
-        vkFreeMemory(device_.logicalDevice, textureImageMemory[i], nullptr);
+        freeMemory(device_.logicalDevice, textureImageMemory[i]);
     }
 
-    for (size_t i = 0; i < colourBufferImages.size(); ++i) {
-        vkDestroyImageView(device_.logicalDevice, colourBufferImageView[i], nullptr);
-        vkDestroyImage(device_.logicalDevice, colourBufferImages[i], nullptr);
-        vkFreeMemory(device_.logicalDevice, colourBufferImageMemory[i], nullptr);
-    }
+    RenderGraph::destroyImages(device_.logicalDevice, attachmentImages);
 
-    for (size_t i = 0; i < depthBufferImages.size(); ++i) {
-        vkDestroyImageView(device_.logicalDevice, depthBufferImageView[i], nullptr);
-        vkDestroyImage(device_.logicalDevice, depthBufferImages[i], nullptr);
-        vkFreeMemory(device_.logicalDevice, depthBufferImageMemory[i], nullptr);
-    }
+    destroyFrameContexts();
+    destroyObjectBuffers();
+    geometryHeap.clean();
+    frameCapture.clean();
 
-    vkDestroyDescriptorPool(device_.logicalDevice, descriptorPool, nullptr);
+    descriptorAllocator.clean();
     vkDestroyDescriptorSetLayout(device_.logicalDevice, descriptorSetLayout, nullptr);
 
-    for (size_t i = 0; i < swapChainImages_.size(); ++i) {
-        vkDestroyBuffer(device_.logicalDevice, vpUniformBuffer[i], nullptr);
-        vkFreeMemory(device_.logicalDevice, vpUniformBufferMemory[i], nullptr);
-//        vkDestroyBuffer(device_.logicalDevice, modelDUniformBuffer[i], nullptr);
-//        vkFreeMemory(device_.logicalDevice, modelDUniformBufferMemory[i], nullptr);
+    vkDestroyCommandPool(device_.logicalDevice, graphicsCommandPool, nullptr);
+
+    for (auto& framebuffer : swapChainFramebuffers_) {
+        vkDestroyFramebuffer(device_.logicalDevice, framebuffer, nullptr);
+    }
+
+    shaderWatcher.clean();
+
+    for (auto& slot : pipelineSlots) {
+        if (!slot.pending.valid()) continue;
+
+        // Wait for rebuilds still compiling, their pipelines were never used
+        try {
+            vkDestroyPipeline(device_.logicalDevice, slot.pending.get(), nullptr);
+        } catch (const std::exception&) {  }
     }
 
-    for (size_t i = 0; i < MAX_FRAME_DRAWS; ++i) {
-        vkDestroySemaphore(device_.logicalDevice, renderFinished[i], nullptr);
-        vkDestroySemaphore(device_.logicalDevice, imageAvailable[i], nullptr);
-        vkDestroyFence(device_.logicalDevice, drawFences[i], nullptr);
+    pipelineSlots.clear();
+
+    for (auto& build : discardedBuilds) {
+        try {
+            vkDestroyPipeline(device_.logicalDevice, build.get(), nullptr);
+        } catch (const std::exception&) {  }
     }
 
-    vkDestroyCommandPool(device_.logicalDevice, graphicsCommandPool, nullptr);
+    discardedBuilds.clear();
+    vkDestroyPipeline(device_.logicalDevice, retiredSecondPipeline, nullptr);
+    retiredSecondPipeline = VK_NULL_HANDLE;
 
-    for (auto& framebuffer : swapChainFramebuffers_) {
-        vkDestroyFramebuffer(device_.logicalDevice, framebuffer, nullptr);
+    // Keep what was compiled this run for the next launch
+    pipelineCache.save();
+    pipelineCache.clean();
+
+    for (auto& [variant, pipeline] : pipelineVariants) {
+        vkDestroyPipeline(device_.logicalDevice, pipeline, nullptr);
     }
 
-    vkDestroyPipeline(device_.logicalDevice, secondPipeline, nullptr);
+    pipelineVariants.clear();
     vkDestroyPipelineLayout(device_.logicalDevice, secondPipeLineLayout, nullptr);
 
     vkDestroyPipeline(device_.logicalDevice, graphicsPipeline_, nullptr);
+    vkDestroyPipeline(device_.logicalDevice, depthPrePassPipeline, nullptr);
+    vkDestroyPipeline(device_.logicalDevice, depthEqualPipeline, nullptr);
     vkDestroyPipelineLayout(device_.logicalDevice, pipelineLayout, nullptr);
     vkDestroyRenderPass(device_.logicalDevice, renderPass_, nullptr);
 
@@ -198,15 +327,194 @@ void VulkanRenderer::clean() {
 
     vkDestroySwapchainKHR(device_.logicalDevice, swapChain_, nullptr);
     vkDestroySurfaceKHR(instance_, surface_, nullptr);
+    graphicsTimeline.clean();
+    MemoryTracker::get().clean();
     vkDestroyDevice(device_.logicalDevice, nullptr);
     validationLayers->clean(instance_);
     vkDestroyInstance(instance_, nullptr);
 }
 
-void VulkanRenderer::updateModel(int modelID, glm::mat4 newModel) {
-    if (modelID >= modelList.size()) return;
+void VulkanRenderer::recreateSwapChain() {
+    // Minimised: keep the current swap chain until the window has a size again
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window_->window_, &width, &height);
+
+    if (width == 0 || height == 0) return;
+
+    spdlog::info("[Vulkan-Renderer] Recreate swap chain ({}x{})", width, height);
+
+    // Frames in flight still render to the old swap chain and attachments, hand them over for later destruction
+    auto retiredSwapChain = std::make_shared<RetiredSwapChain>();
+    RetiredSwapChain& retired = *retiredSwapChain;
+    retired.swapChain = swapChain_;
+    retired.framebuffers = std::move(swapChainFramebuffers_);
+
+    for (auto& image : swapChainImages_) {
+        retired.imageViews.push_back(image.imageView);
+    }
+
+    retired.attachments = std::move(attachmentImages);
+
+    swapChainImages_.clear();
+    swapChainFramebuffers_.clear();
+
+    // A lost surface can't hand anything over, the new swap chain starts from a new surface
+    if (surfaceLost) {
+        retired.surface = surface_;
+        swapChain_ = VK_NULL_HANDLE;
+        createSurface();
+    }
+
+    // Old swap chain is passed as oldSwapchain, it retires once its presented images are released
+    createSwapChain();
+    createAttachmentImages();
+    createFramebuffers();
+
+    deletionQueue.push(graphicsTimeline.getSubmittedValue(), [this, retiredSwapChain] { destroyRetiredSwapChain(*retiredSwapChain); });
+
+    // Viewport/scissor are dynamic, only the projection and the split position follow the new size
+    updateProjection();
+    setPostProcessMode(postProcessMode);
+
+    swapChainOutOfDate = false;
+    surfaceLost = false;
+}
+
+void VulkanRenderer::destroyRetiredSwapChain(RetiredSwapChain& retired) {
+    for (auto framebuffer : retired.framebuffers) {
+        vkDestroyFramebuffer(device_.logicalDevice, framebuffer, nullptr);
+    }
+
+    RenderGraph::destroyImages(device_.logicalDevice, retired.attachments);
+
+    for (auto imageView : retired.imageViews) {
+        vkDestroyImageView(device_.logicalDevice, imageView, nullptr);
+    }
+
+    vkDestroySwapchainKHR(device_.logicalDevice, retired.swapChain, nullptr);
+
+    if (retired.surface) vkDestroySurfaceKHR(instance_, retired.surface, nullptr);
+}
+
+void VulkanRenderer::updateProjection() {
+    uboViewProjection.projection = glm::perspective(glm::radians(45.0f),
+                                                    static_cast<float>(swapChainExtent_.width) / static_cast<float>(swapChainExtent_.height),
+                                                    CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
+
+    uboViewProjection.projection[1][1] *= -1;
+}
+
+void VulkanRenderer::setTextureBudget(VkDeviceSize budget) {
+    textureStreamer.setBudget(budget);
+}
+
+void VulkanRenderer::setPostProcessMode(PostProcessMode mode) {
+    // The current variant stays bound until the new one is built (they all are after init)
+    postProcessMode = mode;
+    postProcessVariant = requestPipelineVariant(getPostProcessDesc(mode));
+
+    if (mode != PostProcessMode::SPLIT) return;
+
+    // The split of the previous window width is never used again
+    if (splitVariant && splitVariant != postProcessVariant) retirePipelineVariant(splitVariant);
+    splitVariant = postProcessVariant;
+}
+
+void VulkanRenderer::setPresentPolicy(PresentPolicy policy) {
+    if (policy == presentPolicy) return;
+
+    // The present mode is fixed at swap chain creation, the next frame rebuilds it
+    presentPolicy = policy;
+    swapChainOutOfDate = true;
+}
+
+void VulkanRenderer::setFrameLimit(double maxFps) {
+    frameLimiter.setMaxFps(maxFps);
+}
+
+void VulkanRenderer::setFramesInFlight(uint32_t count) {
+    count = std::clamp(count, 1u, MAX_FRAMES_IN_FLIGHT);
+
+    if (count == framesInFlight) return;
+
+    framesInFlight = count;
+
+    // Not initialised yet, the frames are created with the new count
+    if (frames.empty()) return;
+
+    // Attachments are per frame too, they are rebuilt with the swap chain before the next frame
+    swapChainOutOfDate = true;
+
+    spdlog::info("[Vulkan-Renderer] {} frames in flight", count);
+
+    // Rare setting, simply wait for every frame to finish and rebuild them all
+    vkDeviceWaitIdle(device_.logicalDevice);
+    deletionQueue.flushAll();
+
+    destroyFrameContexts();
+    createFrameContexts();
+    createObjectBuffers(objectCapacity); // Staging has a slice per frame
+    createDescriptorSets();
+
+    currentFrame = 0;
+}
+
+void VulkanRenderer::setDepthPrePass(bool enabled) {
+    // Both scene pipelines are built up front, the next recorded frame just uses the other one
+    depthPrePass = enabled;
+}
+
+void VulkanRenderer::setMemoryWarningThreshold(float fraction) {
+    MemoryTracker::get().setWarningThreshold(fraction);
+}
+
+MemoryStats VulkanRenderer::getMemoryStats() const {
+    return MemoryTracker::get().getStats();
+}
+
+void VulkanRenderer::captureFrame(const std::string& path, CaptureFormat format) {
+    frameCapture.requestCapture(path, format);
+}
+
+void VulkanRenderer::setCaptureRecording(const std::string& directory, CaptureFormat format) {
+    frameCapture.setRecording(directory, format);
+}
+
+void VulkanRenderer::updateModel(ModelHandle model, glm::mat4 newModel) {
+    // Stale handles (destroyed models) are ignored
+    MeshModel* meshModel = modelList.get(model);
+
+    if (!meshModel) return;
+
+    meshModel->setModel({newModel});
+
+    // Only moved models have their record uploaded with the next frame
+    objectData[model.index].model = newModel;
+    markObjectDirty(model.index);
+}
+
+void VulkanRenderer::destroyMeshModel(ModelHandle model) {
+    std::optional<MeshModel> meshModel = modelList.erase(model);
+
+    if (!meshModel) return;
+
+    // Packets point at its buffers, and the model indices of the others may have moved
+    drawListDirty = true;
+
+    // Shared geometry is only destroyed by the last model using it, same for the textures of that geometry
+    std::vector<TextureResource> releasedTextures;
+    bool lastUser = meshModel->getResourceKey().empty() ||
+                    resourceRegistry.releaseGeometry(meshModel->getResourceKey(), &releasedTextures);
+
+    for (const auto& texture : releasedTextures) {
+        destroyTexture(texture);
+    }
+
+    if (!lastUser) return;
 
-    modelList[modelID].setModel({newModel});
+    // Frames in flight may still draw the model, its buffers go once they have finished (and stay where they are)
+    meshModel->retireGeometry();
+    deletionQueue.push(graphicsTimeline.getSubmittedValue(), [model = std::move(*meshModel)]() mutable { model.clean(); });
 }
 
 void VulkanRenderer::createInstance() {
@@ -320,13 +628,98 @@ void VulkanRenderer::createLogicalDevice() {
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queuesCreateInfos.size()); // Number of Queue create info
     deviceCreateInfo.pQueueCreateInfos = queuesCreateInfos.data(); // List of queue create infos so device can create required queues
-    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()); // number of enable Logical device extensions
-    deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data(); // List of enable Logical device extensions
+
+    // Optional extensions on top of the required ones
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+
+    // Heap budgets and usage of the whole process, queried every frame
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(device_.physicalDevice, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device_.physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    bool memoryBudget = std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties& extension) {
+        return strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+    });
+
+    if (memoryBudget) enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size()); // number of enable Logical device extensions
+    deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data(); // List of enable Logical device extensions
 
     // Physical Device Features the logical Device will be using
+    VkPhysicalDeviceFeatures supportedFeatures{};
+    vkGetPhysicalDeviceFeatures(device_.physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE; // Enable Anisotropy
 
+    // Block compressed texture formats, whichever the device has (desktop usually BC, mobile ASTC/ETC2)
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+    deviceFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+
+    // Descriptor indexing (core in 1.2) puts every texture in one partially bound array, indexed per draw
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device_.physicalDevice, &deviceProperties);
+
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+    if (deviceProperties.apiVersion >= VK_API_VERSION_1_2) {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &indexingFeatures;
+
+        vkGetPhysicalDeviceFeatures2(device_.physicalDevice, &features2);
+
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &indexingProperties;
+
+        vkGetPhysicalDeviceProperties2(device_.physicalDevice, &properties2);
+    }
+
+    // The array is written while frames that bound it are pending (textures loaded at runtime, reused slots), which is
+    // only legal with update after bind for slots those frames don't use
+    bindlessTextures = supportedFeatures.shaderSampledImageArrayDynamicIndexing &&
+                       indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound &&
+                       indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+                       indexingFeatures.descriptorBindingUpdateUnusedWhilePending;
+
+    // Timeline semaphores (core in 1.2, required by checkDeviceSuitable) order frames, uploads and retirement
+    VkPhysicalDeviceTimelineSemaphoreFeatures enabledTimelineFeatures{};
+    enabledTimelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    enabledTimelineFeatures.timelineSemaphore = VK_TRUE;
+    deviceCreateInfo.pNext = &enabledTimelineFeatures;
+
+    VkPhysicalDeviceDescriptorIndexingFeatures enabledIndexingFeatures{};
+    enabledIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+    if (bindlessTextures) {
+        deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+        enabledIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        enabledIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        enabledIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        enabledIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        enabledTimelineFeatures.pNext = &enabledIndexingFeatures;
+
+        // Update after bind sets have their own (usually higher) limits
+        maxBindlessTextures = std::min({ MAX_BINDLESS_TEXTURES,
+                                         indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                         indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                         indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+                                         indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                         indexingProperties.maxPerStageUpdateAfterBindResources });
+
+        spdlog::info("[Vulkan-Renderer] Bindless textures ({} slots)", maxBindlessTextures);
+    } else {
+        spdlog::info("[Vulkan-Renderer] No descriptor indexing, one descriptor set per texture");
+    }
+
     deviceCreateInfo.pEnabledFeatures = &deviceFeatures; // Physical Device features Logical Device will use
 
     // Create the logical device for the given physical device
@@ -340,6 +733,12 @@ void VulkanRenderer::createLogicalDevice() {
     // From given logical device, of given Queue Family, of given Queue Index (0 since only one queue), place reference in given vkQueue
     vkGetDeviceQueue(device_.logicalDevice, indices.graphicsFamily.value(), 0, &graphicsQueues_);
     vkGetDeviceQueue(device_.logicalDevice, indices.presentationFamily.value(), 0, &presentationQueue_);
+
+    graphicsTimeline.init(device_.logicalDevice, graphicsQueues_);
+
+    MemoryTracker::get().init(device_.physicalDevice, memoryBudget);
+
+    if (!memoryBudget) spdlog::info("[Vulkan-Renderer] No VK_EXT_memory_budget, memory budgets are estimated");
 }
 
 void VulkanRenderer::createSurface() {
@@ -360,6 +759,20 @@ void VulkanRenderer::createSwapChain() {
     VkPresentModeKHR presentMode = chooseBestPresentationMode(swapChainDetails.presentationModes);
     VkExtent2D extent = chooseSwapExtent(swapChainDetails.surfaceCapabilities);
 
+    // The render pass, pipelines and frame capture were built for the first swap chain's format: a swap chain on a new
+    // surface (after it was lost) keeps that format, a surface without it can't be rendered to
+    if (swapChainImageFormat_ != VK_FORMAT_UNDEFINED) {
+        const auto& formats = swapChainDetails.formats;
+        bool anyFormat = formats.size() == 1 && formats[0].format == VK_FORMAT_UNDEFINED;
+        bool supported = anyFormat || std::any_of(formats.begin(), formats.end(), [this](const auto& format) {
+            return format.format == swapChainImageFormat_ && format.colorSpace == swapChainColorSpace_;
+        });
+
+        if (!supported) throw std::runtime_error("The new surface doesn't support the format of the swap chain");
+
+        surfaceFormat = { swapChainImageFormat_, swapChainColorSpace_ };
+    }
+
     // How many images are in the swap chain? Get 1 more than the minimum to allow triple buffering
     uint32_t imageCount = swapChainDetails.surfaceCapabilities.minImageCount + 1;
 
@@ -385,6 +798,15 @@ void VulkanRenderer::createSwapChain() {
     swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR; // How to handle blending images with external graphics (e.g. other windows)
     swapChainCreateInfo.clipped = VK_TRUE; // Whether to clip parts of image not in view (e.g. behind another window. off screen, etc)
 
+    // Frame captures copy the presented image out, most surfaces allow it
+    swapChainReadable = swapChainDetails.surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+    if (swapChainReadable) {
+        swapChainCreateInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    } else {
+        spdlog::warn("[Vulkan-Renderer] Swap chain images can't be copied, frames won't be captured");
+    }
+
     // Get queue Family indices
     QueueFamilyIndices indices = getQueueFamilies(device_.physicalDevice);
 
@@ -405,7 +827,8 @@ void VulkanRenderer::createSwapChain() {
     }
 
     // If old swap chain been destroyed and this one replaces it, the link old one to quickly hand over responsibilities
-    swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+    // (null on the first creation and after a surface loss)
+    swapChainCreateInfo.oldSwapchain = swapChain_;
 
     // Create Swapchain
     VkResult result = vkCreateSwapchainKHR(device_.logicalDevice, &swapChainCreateInfo, nullptr, &swapChain_);
@@ -416,6 +839,7 @@ void VulkanRenderer::createSwapChain() {
 
     // Store for later reference
     swapChainImageFormat_ = surfaceFormat.format;
+    swapChainColorSpace_ = surfaceFormat.colorSpace;
     swapChainExtent_ = extent;
 
     // Get Swapchain images (first count, then values)
@@ -428,7 +852,7 @@ void VulkanRenderer::createSwapChain() {
         // Store image handle
         SwapChainImage swapChainImage{
             .image = image,
-            .imageView = createImageView(image, swapChainImageFormat_, VK_IMAGE_ASPECT_COLOR_BIT)
+            .imageView = createImageView(image, swapChainImageFormat_, VK_IMAGE_ASPECT_COLOR_BIT, 1)
         };
 
         // Add to swapcahin images list
@@ -437,13 +861,90 @@ void VulkanRenderer::createSwapChain() {
 }
 
 void VulkanRenderer::createGraphicsPipeline() {
-    // Read in SPIR-V code of shaders
-    auto vertexShaderCode = readFile("../shaders/shader.vert.spv");
-    auto fragmentShaderCode = readFile("../shaders/shader.frag.spv");
+    // -- PIPELINE LAYOUT --
+    std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts{
+        descriptorSetLayout,
+        samplerSetLayout
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+    pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
+    pipelineLayoutCreateInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutCreateInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    // Create pipeline layout
+    VkResult result = vkCreatePipelineLayout(device_.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout);
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Pipeline Layout");
+    }
+
+    // Second pass pipeline layout (input attachment descriptor sets)
+    VkPipelineLayoutCreateInfo secondPipelineLayoutCreateInfo{};
+    secondPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    secondPipelineLayoutCreateInfo.setLayoutCount = 1;
+    secondPipelineLayoutCreateInfo.pSetLayouts = &inputSetLayout;
+    secondPipelineLayoutCreateInfo.pushConstantRangeCount = 0;
+    secondPipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+
+    result = vkCreatePipelineLayout(device_.logicalDevice, &secondPipelineLayoutCreateInfo, nullptr, &secondPipeLineLayout);
+
+    if (result != VK_SUCCESS) throw std::runtime_error("Failed to created a Pipeline Layout");
+
+    // -- PIPELINES --
+    // What each pipeline is built from, kept so they can be rebuilt when their shaders change
+    std::string sceneFragmentShader = bindlessTextures ? "bindless.frag.spv" : "shader.frag.spv";
+
+    pipelineSlots.clear();
+    pipelineSlots.push_back({ { "shader.vert.spv", sceneFragmentShader, pipelineLayout, renderGraph.getSubpass(scenePass),
+                                VertexLayout::FULL, true }, &graphicsPipeline_ });
+
+    // Depth pre-pass, then the scene again only shading the visible fragments (depth already complete)
+    pipelineSlots.push_back({ { "depth.vert.spv", "", pipelineLayout, renderGraph.getSubpass(depthPrePassPass),
+                                VertexLayout::POSITION, true }, &depthPrePassPipeline });
+    pipelineSlots.push_back({ { "shader.vert.spv", sceneFragmentShader, pipelineLayout, renderGraph.getSubpass(scenePass),
+                                VertexLayout::FULL, false, VK_COMPARE_OP_EQUAL }, &depthEqualPipeline });
+
+    // Compile every pipeline on the worker threads at once
+    for (auto& slot : pipelineSlots) {
+        requestPipelineBuild(slot);
+    }
+
+    // Every post process variant, so switching modes later doesn't wait for a compile
+    for (PostProcessMode mode : { PostProcessMode::COLOUR, PostProcessMode::DEPTH, PostProcessMode::SPLIT }) {
+        uint64_t variant = requestPipelineVariant(getPostProcessDesc(mode));
+
+        if (mode == postProcessMode) postProcessVariant = variant;
+        if (mode == PostProcessMode::SPLIT) splitVariant = variant;
+    }
+
+    // The first frame needs the scene pipelines and the variant of the current mode, the others land in the background
+    for (auto& slot : pipelineSlots) {
+        if (slot.pipeline != &graphicsPipeline_ && slot.pipeline != &depthPrePassPipeline &&
+            slot.pipeline != &depthEqualPipeline && slot.pipeline != &pipelineVariants[postProcessVariant]) continue;
+
+        *slot.pipeline = slot.pending.get();
+    }
+
+    secondPipeline = pipelineVariants[postProcessVariant];
+
+    // Development: rebuild pipelines when a shader in the override directory is rewritten
+    if (shaderRegistry.hasOverrideDirectory()) shaderWatcher.init(shaderRegistry.getOverrideDirectory());
+}
+
+VkPipeline VulkanRenderer::buildPipeline(const PipelineDesc& desc) {
+    // Runs on a worker thread: only reads renderer state that doesn't change while pipelines are in flight
+    // Get SPIR-V code of shaders (embedded in the executable)
+    auto vertexShaderCode = shaderRegistry.getCode(desc.vertexShader);
+
+    // Depth only pipelines have no fragment stage
+    bool depthOnly = desc.fragmentShader.empty();
 
     // Create shaders module
     VkShaderModule vertShaderModule = createShaderModule(vertexShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragmentShaderCode);
+    VkShaderModule fragShaderModule = depthOnly ? VK_NULL_HANDLE : createShaderModule(shaderRegistry.getCode(desc.fragmentShader));
 
     // -- SHADER STAGE CREATION INFORMATION --
     // Vertex stage creation information
@@ -462,6 +963,16 @@ void VulkanRenderer::createGraphicsPipeline() {
         .pName = "main"
     };
 
+    // Constant values baked into the fragment shader, the driver drops the code they switch off
+    VkSpecializationInfo specializationInfo{
+        .mapEntryCount = static_cast<uint32_t>(desc.specializationEntries.size()),
+        .pMapEntries = desc.specializationEntries.data(),
+        .dataSize = desc.specializationData.size(),
+        .pData = desc.specializationData.data()
+    };
+
+    if (!desc.specializationEntries.empty()) fragmentShaderCreateInfo.pSpecializationInfo = &specializationInfo;
+
     // Put shader stage creation info in to array
     // Graphics Pipeline creation info requires array of shader stage creates
     VkPipelineShaderStageCreateInfo shaderStages[] = {
@@ -514,6 +1025,24 @@ void VulkanRenderer::createGraphicsPipeline() {
         .pVertexAttributeDescriptions = attributeDescriptions.data(), // List of Vertex Attribute Descriptions (data description and where to bind to/from)
     };
 
+    // Positions only, tightly packed in their own buffer
+    VkVertexInputBindingDescription positionBindingDescription{ 0, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX };
+    VkVertexInputAttributeDescription positionAttributeDescription{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 };
+
+    if (desc.vertexLayout == VertexLayout::POSITION) {
+        vertexInputStateCreateInfo.pVertexBindingDescriptions = &positionBindingDescription;
+        vertexInputStateCreateInfo.vertexAttributeDescriptionCount = 1;
+        vertexInputStateCreateInfo.pVertexAttributeDescriptions = &positionAttributeDescription;
+    }
+
+    // No vertex data for the second pass
+    if (desc.vertexLayout == VertexLayout::NONE) {
+        vertexInputStateCreateInfo.vertexBindingDescriptionCount = 0;
+        vertexInputStateCreateInfo.pVertexBindingDescriptions = nullptr;
+        vertexInputStateCreateInfo.vertexAttributeDescriptionCount = 0;
+        vertexInputStateCreateInfo.pVertexAttributeDescriptions = nullptr;
+    }
+
     // -- INPUT ASSEMBLY --
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
@@ -522,43 +1051,28 @@ void VulkanRenderer::createGraphicsPipeline() {
     };
 
     // -- VIEWPORT & SCISSOR --
-    // Create viewport info struct
-    VkViewport viewport{
-        .x = 0.0f,
-        .y = 0.0f,
-        .width = static_cast<float>(swapChainExtent_.width),
-        .height = static_cast<float>(swapChainExtent_.height),
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f
-    };
-
-    // Create scissor info struct
-    VkRect2D scissor{
-        .offset = {0, 0}, // Offset to use region from
-        .extent = swapChainExtent_ // Extent to describe region to use, starting on offset
-    };
-
+    // Set when recording (dynamic), so pipelines don't depend on the swap chain size
     VkPipelineViewportStateCreateInfo viewportStateCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
         .viewportCount = 1,
-        .pViewports = &viewport,
+        .pViewports = nullptr,
         .scissorCount = 1,
-        .pScissors = &scissor,
+        .pScissors = nullptr,
     };
 
     // -- DYNAMIC STATES --
     // Dynamic states to enable
-//    std::vector<VkDynamicState> dynamicStateEnables{
-//        VK_DYNAMIC_STATE_VIEWPORT, // Dynamic Viewport: Can resize in command buffer with vkCmdSetViewport(commandBuffer, 0, 1, &viewport)
-//        VK_DYNAMIC_STATE_SCISSOR // Dynamic Scissor: Can resize in command with vkCmdSetScissor(commandBuffet, 0, 1, &scissor)
-//    };
+    std::vector<VkDynamicState> dynamicStateEnables{
+        VK_DYNAMIC_STATE_VIEWPORT, // Dynamic Viewport: Can resize in command buffer with vkCmdSetViewport(commandBuffer, 0, 1, &viewport)
+        VK_DYNAMIC_STATE_SCISSOR // Dynamic Scissor: Can resize in command with vkCmdSetScissor(commandBuffet, 0, 1, &scissor)
+    };
 
     // Dynamic State create info
-//    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{
-//        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-//        .dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size()),
-//        .pDynamicStates = dynamicStateEnables.data()
-//    };
+    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size()),
+        .pDynamicStates = dynamicStateEnables.data()
+    };
 
     // -- RASTERIZER --
     VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo{
@@ -604,43 +1118,23 @@ void VulkanRenderer::createGraphicsPipeline() {
     VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
         .logicOpEnable = VK_FALSE, // Alternative to calculations is to use logical operations
-        .attachmentCount = 1,
+        .attachmentCount = depthOnly ? 0u : 1u, // Depth only subpasses have no colour attachment
         .pAttachments = &colorBlendAttachmentState
     };
 
-    // -- PIPELINE LAYOUT --
-    std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts{
-        descriptorSetLayout,
-        samplerSetLayout
-    };
-
-    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
-    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-    pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
-
-    // Create pipeline layout
-    VkResult result = vkCreatePipelineLayout(device_.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout);
-
-    if (result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create Pipeline Layout");
-    }
-
     // -- DEPTH STENCIL TESTING --
     VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo{};
     depthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
     depthStencilStateCreateInfo.depthTestEnable = VK_TRUE; // Enable checking depth to determine fragment write
-    depthStencilStateCreateInfo.depthWriteEnable = VK_TRUE; // Enable writing to depth buffer (to replace old values)
-    depthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS; // Comparison operation that allows an overwrite (is in front)
+    depthStencilStateCreateInfo.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE; // Enable writing to depth buffer (to replace old values)
+    depthStencilStateCreateInfo.depthCompareOp = desc.depthCompare; // Comparison operation that allows an overwrite (LESS: is in front)
     depthStencilStateCreateInfo.depthBoundsTestEnable = VK_FALSE; // Depth Bounds Test: Does the depth value exists between two bounds
     depthStencilStateCreateInfo.stencilTestEnable = VK_FALSE; // Enable Stencil Test
 
     // -- GRAPHICS PIPELINE CREATION --
     VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo{
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .stageCount = 2, // Number of shader stages
+        .stageCount = depthOnly ? 1u : 2u, // Number of shader stages
         .pStages = shaderStages, // List of shader stages
         .pVertexInputState = &vertexInputStateCreateInfo, // All the fixed functions pipeline states
         .pInputAssemblyState = &inputAssemblyStateCreateInfo,
@@ -649,224 +1143,231 @@ void VulkanRenderer::createGraphicsPipeline() {
         .pMultisampleState = &multisampleStateCreateInfo,
         .pDepthStencilState = &depthStencilStateCreateInfo,
         .pColorBlendState = &colorBlendStateCreateInfo,
-        .pDynamicState = nullptr,
-        .layout = pipelineLayout, // Pipeline layout pipeline should use
+        .pDynamicState = &dynamicStateCreateInfo,
+        .layout = desc.layout, // Pipeline layout pipeline should use
         .renderPass = renderPass_, // Render pass description the pipeline is compatible with
-        .subpass = 0, // Subpass of render pass to use witch pipeline
+        .subpass = desc.subpass, // Subpass of render pass to use witch pipeline
     };
 
     // Pipeline Derivatives : Can create multiple pipelines that derive from another for optimisation
     graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE; // Existing pipeline to derive from
     graphicsPipelineCreateInfo.basePipelineIndex = -1; // or index of pipeline being created derive from (in case creating multiple at once)
 
-    // Create Graphics Pipeline
-    result = vkCreateGraphicsPipelines(device_.logicalDevice, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &graphicsPipeline_);
-
-    if (result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create a graphics pipeline");
-    }
+    // Create Graphics Pipeline (the cache is internally synchronised, pipelines can be built from several threads)
+    VkPipeline pipeline{};
+    VkResult result = vkCreateGraphicsPipelines(device_.logicalDevice, pipelineCache.getCache(), 1,
+                                                &graphicsPipelineCreateInfo, nullptr, &pipeline);
 
     // Destroy Shader Modules, no longer needed after Pipeline created
     vkDestroyShaderModule(device_.logicalDevice, vertShaderModule, nullptr);
-    vkDestroyShaderModule(device_.logicalDevice, fragShaderModule, nullptr);
+    if (fragShaderModule) vkDestroyShaderModule(device_.logicalDevice, fragShaderModule, nullptr);
 
-    // CREATE SECOND PASS PIPELINE
-    // Second pass shaders
-    auto secondVertexShaderCode = readFile("../shaders/second.vert.spv");
-    auto secondFragmentShaderCode = readFile("../shaders/second.frag.spv");
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create a graphics pipeline");
+    }
 
-    // Build shaders
-    VkShaderModule secondVertexShaderModule = createShaderModule(secondVertexShaderCode);
-    VkShaderModule secondFragmentShaderModule = createShaderModule(secondFragmentShaderCode);
+    return pipeline;
+}
 
-    // Set new shaders
-    vertexShaderCreateInfo.module = secondVertexShaderModule;
-    fragmentShaderCreateInfo.module = secondFragmentShaderModule;
+void VulkanRenderer::requestPipelineBuild(PipelineSlot& slot) {
+    // A build already in flight may have read the old shaders, build again once it lands
+    if (slot.pending.valid()) {
+        slot.rebuildQueued = true;
+        return;
+    }
 
-    VkPipelineShaderStageCreateInfo secondShaderStages[] = { vertexShaderCreateInfo, fragmentShaderCreateInfo };
+    PipelineDesc desc = slot.desc;
+    slot.pending = threadPool.submit([this, desc] { return buildPipeline(desc); });
+}
 
-    // No vertex data for second pass
-    vertexInputStateCreateInfo.vertexBindingDescriptionCount = 0;
-    vertexInputStateCreateInfo.pVertexBindingDescriptions = nullptr;
-    vertexInputStateCreateInfo.vertexAttributeDescriptionCount = 0;
-    vertexInputStateCreateInfo.pVertexAttributeDescriptions = nullptr;
+void VulkanRenderer::updatePipelines() {
+    // Rebuild every pipeline using a shader that was just written
+    for (const auto& fileName : shaderWatcher.poll()) {
+        for (auto& slot : pipelineSlots) {
+            if (slot.desc.vertexShader == fileName || slot.desc.fragmentShader == fileName) {
+                spdlog::info("[Vulkan-Renderer] {} changed, rebuilding pipeline", fileName);
+                requestPipelineBuild(slot);
+            }
+        }
+    }
 
-    // Don't want to write to depth buffer
-    depthStencilStateCreateInfo.depthWriteEnable = VK_FALSE;
+    // Swap in finished pipelines, the command buffers recorded from this frame on use them
+    for (auto& slot : pipelineSlots) {
+        if (!slot.pending.valid() ||
+            slot.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
 
-    // Create new pipleine layout
-    VkPipelineLayoutCreateInfo secondPipelineLayoutCreateInfo{};
-    secondPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    secondPipelineLayoutCreateInfo.setLayoutCount = 1;
-    secondPipelineLayoutCreateInfo.pSetLayouts = &inputSetLayout;
-    secondPipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-    secondPipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+        try {
+            VkPipeline pipeline = slot.pending.get();
 
-    result = vkCreatePipelineLayout(device_.logicalDevice, &secondPipelineLayoutCreateInfo, nullptr, &secondPipeLineLayout);
+            // Frames still in flight may use the old one
+            VkPipeline oldPipeline = *slot.pipeline;
+            deletionQueue.push(graphicsTimeline.getSubmittedValue(), [this, oldPipeline] {
+                vkDestroyPipeline(device_.logicalDevice, oldPipeline, nullptr);
+            });
 
-    if (result != VK_SUCCESS) throw std::runtime_error("Failed to created a Pipeline Layout");
+            *slot.pipeline = pipeline;
+        } catch (const std::exception& e) {
+            // Broken shader while iterating: keep drawing with the pipeline we have
+            spdlog::info("[Vulkan-Renderer] Pipeline rebuild failed, keeping the old one: {}", e.what());
+        }
 
-    graphicsPipelineCreateInfo.pStages = secondShaderStages;	// Update second shader stage list
-    graphicsPipelineCreateInfo.layout = secondPipeLineLayout;	// Change pipeline layout for input attachment descriptor sets
-    graphicsPipelineCreateInfo.subpass = 1;						// Use second subpass
+        if (slot.rebuildQueued) {
+            slot.rebuildQueued = false;
+            requestPipelineBuild(slot);
+        }
+    }
 
-    // Create second pipeline
-    result = vkCreateGraphicsPipelines(device_.logicalDevice, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &secondPipeline);
-    if (result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create a Graphics Pipeline!");
+    // Follow the variant of the current mode once it is built (or rebuilt)
+    if (VkPipeline variant = pipelineVariants[postProcessVariant]) secondPipeline = variant;
+
+    if (retiredSecondPipeline && retiredSecondPipeline != secondPipeline) {
+        VkPipeline pipeline = retiredSecondPipeline;
+        deletionQueue.push(graphicsTimeline.getSubmittedValue(), [this, pipeline] {
+            vkDestroyPipeline(device_.logicalDevice, pipeline, nullptr);
+        });
+
+        retiredSecondPipeline = VK_NULL_HANDLE;
     }
 
-    // Destroy second shader modules
-    vkDestroyShaderModule(device_.logicalDevice, secondFragmentShaderModule, nullptr);
-    vkDestroyShaderModule(device_.logicalDevice, secondVertexShaderModule, nullptr);
+    // Builds of retired variants were never bound
+    for (auto build = discardedBuilds.begin(); build != discardedBuilds.end();) {
+        if (build->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++build;
+            continue;
+        }
+
+        try {
+            vkDestroyPipeline(device_.logicalDevice, build->get(), nullptr);
+        } catch (const std::exception&) {  }
+
+        build = discardedBuilds.erase(build);
+    }
 }
 
-void VulkanRenderer::createRenderPass() {
-    // ATTACHMENTS
-    // SUBPASS 1 ATTACHMENTS + REFERENCES (INPUT ATTACHMENTS)
+uint64_t VulkanRenderer::hashPipelineDesc(const PipelineDesc& desc) {
+    // Everything that makes two pipelines differ, flattened into bytes
+    std::string key = desc.vertexShader + '\0' + desc.fragmentShader + '\0';
 
-    // Colour Attachment (Input)
-    VkAttachmentDescription colourAttachment{};
-    colourAttachment.format = chooseSupportedFormat(
-            { VK_FORMAT_R8G8B8A8_UNORM },
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-    colourAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colourAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colourAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colourAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colourAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colourAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colourAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    // Depth Attachment (Input)
-    VkAttachmentDescription depthAttachment{};
-    depthAttachment.format = chooseSupportedFormat(
-            { VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT },
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT );
-    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    // Color Attachment (Input) Reference
-    VkAttachmentReference colourAttachmentReference{};
-    colourAttachmentReference.attachment = 1;
-    colourAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    // Depth Attachment (Input) Reference
-    VkAttachmentReference depthAttachmentReference{};
-    depthAttachmentReference.attachment = 2;
-    depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    // Array of subpasses
-    std::array<VkSubpassDescription, 2> subpasses{};
-
-    // Set up Subpass 1
-    subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS; // Pipeline type subpass is to be bound to
-    subpasses[0].colorAttachmentCount = 1;
-    subpasses[0].pColorAttachments = &colourAttachmentReference;
-    subpasses[0].pDepthStencilAttachment = &depthAttachmentReference;
-
-    // SUBPASS 2 ATTACHMENTS + REFERENCES
-
-    // Swapchain Colour attachment
-    VkAttachmentDescription swapchainColourAttachment{
-        .format = swapChainImageFormat_, // Format to use for attachment
-        .samples = VK_SAMPLE_COUNT_1_BIT, // Number of samples to write for multisampling
-        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, // Describes what to do with attachment before rendering
-        .storeOp = VK_ATTACHMENT_STORE_OP_STORE, // Describes what to do with attachment after rendering
-        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE, // Describes what to do with stencil before rendering
-        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE, // Describes what to do with stencil before rendering
+    auto append = [&key](const void* data, size_t size) {
+        key.append(static_cast<const char*>(data), size);
     };
 
-    // Framebuffer data will be stored as an image, but images can be given different data layouts
-    // to give optimal use for certain operations
-    swapchainColourAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // Image data layout before render pass starts
-    swapchainColourAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // Image data layout after render pass(to change to)
+    append(&desc.layout, sizeof(desc.layout));
+    append(&desc.subpass, sizeof(desc.subpass));
+    append(&desc.vertexLayout, sizeof(desc.vertexLayout));
+    append(&desc.depthWrite, sizeof(desc.depthWrite));
+    append(&desc.depthCompare, sizeof(desc.depthCompare));
+    append(desc.specializationEntries.data(), desc.specializationEntries.size() * sizeof(VkSpecializationMapEntry));
+    append(desc.specializationData.data(), desc.specializationData.size());
 
-    // Attachment reference uses an attachment index that refers to index in an attachment list passed to renderPassCreateInfo
-    VkAttachmentReference swapchainColourAttachmentReference{
-        .attachment = 0,
-        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-    };
+    return ResourceRegistry::hashData(key.data(), key.size());
+}
 
-    // References to Attachments that subpass will take input from
-    std::array<VkAttachmentReference, 2> inputReferences{};
-    inputReferences[0].attachment = 1;
-    inputReferences[0].layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    inputReferences[1].attachment = 2;
-    inputReferences[1].layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    // Set up Subpass 2
-    subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS; // Pipeline type subpass is to be bound to
-    subpasses[1].colorAttachmentCount = 1;
-    subpasses[1].pColorAttachments = &swapchainColourAttachmentReference;
-    subpasses[1].inputAttachmentCount = static_cast<uint32_t>(inputReferences.size());
-    subpasses[1].pInputAttachments = inputReferences.data();
-
-    // SUBPASS DEPENDENCIES
-
-    // Need to determine when layout transitions occur using dependencies
-    std::array<VkSubpassDependency, 3> subpassDependencies{};
-
-    // Conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-    subpassDependencies[0] = {
-            .srcSubpass = VK_SUBPASS_EXTERNAL, // Subpass index (VK_SUBPASS_EXTERNAL = Special value meaning outside of renderpass )
-            .dstSubpass = 0,
-            .srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            .srcAccessMask = VK_ACCESS_MEMORY_READ_BIT,
-            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-            .dependencyFlags = 0
-    };
+uint64_t VulkanRenderer::requestPipelineVariant(const PipelineDesc& desc) {
+    uint64_t variant = hashPipelineDesc(desc);
 
-    // Subpass 1 layout (colour/depth) to Subpass 2 layout (shader read)
-    subpassDependencies[1] = {
-            .srcSubpass = 0,
-            .dstSubpass = 1,
-            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-            .dependencyFlags = 0
-    };
+    // Already built or building
+    if (pipelineVariants.count(variant)) return variant;
 
-    // Conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_COLOR_SRC_KHR
-    subpassDependencies[2] = {
-            .srcSubpass = 0,
-            .dstSubpass = VK_SUBPASS_EXTERNAL,
-            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            .dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-            .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
-            .dependencyFlags = 0
-    };
+    // Map nodes never move, the slot can point into it
+    pipelineSlots.push_back({ desc, &pipelineVariants[variant] });
+    requestPipelineBuild(pipelineSlots.back());
+
+    return variant;
+}
+
+void VulkanRenderer::retirePipelineVariant(uint64_t variant) {
+    auto found = pipelineVariants.find(variant);
+    if (found == pipelineVariants.end()) return;
+
+    auto slot = std::find_if(pipelineSlots.begin(), pipelineSlots.end(), [&found](const PipelineSlot& slot) {
+        return slot.pipeline == &found->second;
+    });
+
+    if (slot != pipelineSlots.end()) {
+        // A build still compiling is destroyed once it lands
+        if (slot->pending.valid()) discardedBuilds.push_back(std::move(slot->pending));
+        pipelineSlots.erase(slot);
+    }
+
+    if (VkPipeline pipeline = found->second) {
+        if (pipeline == secondPipeline) {
+            // Bound until the variant replacing it is built
+            retiredSecondPipeline = pipeline;
+        } else {
+            // Frames still in flight may use it
+            deletionQueue.push(graphicsTimeline.getSubmittedValue(), [this, pipeline] {
+                vkDestroyPipeline(device_.logicalDevice, pipeline, nullptr);
+            });
+        }
+    }
+
+    pipelineVariants.erase(found);
+}
 
-    std::array<VkAttachmentDescription, 3> renderPassAttachments{
-        swapchainColourAttachment, colourAttachment, depthAttachment
+PipelineDesc VulkanRenderer::getPostProcessDesc(PostProcessMode mode) const {
+    PostProcessConstants constants{
+        .mode = mode,
+        .splitX = mode == PostProcessMode::SPLIT ? swapChainExtent_.width / 2 : 0, // Only part of the split variant
+        .depthLowerBound = 0.98f,
+        .depthUpperBound = 1.0f
     };
 
-    VkRenderPassCreateInfo renderPassCreateInfo{
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-        .attachmentCount = static_cast<uint32_t>(renderPassAttachments.size()),
-        .pAttachments = renderPassAttachments.data(),
-        .subpassCount = static_cast<uint32_t>(subpasses.size()),
-        .pSubpasses = subpasses.data(),
-        .dependencyCount = static_cast<uint32_t>(subpassDependencies.size()),
-        .pDependencies = subpassDependencies.data()
+    PipelineDesc desc{ "second.vert.spv", "second.frag.spv", secondPipeLineLayout, renderGraph.getSubpass(postProcessPass),
+                       VertexLayout::NONE, false };
+
+    desc.specializationEntries = {
+        { 0, offsetof(PostProcessConstants, mode), sizeof(constants.mode) },
+        { 1, offsetof(PostProcessConstants, splitX), sizeof(constants.splitX) },
+        { 2, offsetof(PostProcessConstants, depthLowerBound), sizeof(constants.depthLowerBound) },
+        { 3, offsetof(PostProcessConstants, depthUpperBound), sizeof(constants.depthUpperBound) }
     };
 
-    VkResult result = vkCreateRenderPass(device_.logicalDevice, &renderPassCreateInfo, nullptr, &renderPass_);
+    auto data = reinterpret_cast<const char*>(&constants);
+    desc.specializationData.assign(data, data + sizeof(constants));
 
-    if (result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create render pass");
-    }
+    return desc;
+}
+
+void VulkanRenderer::createRenderPass() {
+    // ATTACHMENTS
+    colourBufferFormat = chooseSupportedFormat(
+            { VK_FORMAT_R8G8B8A8_UNORM },
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+
+    // Nothing uses stencil, so depth only formats first (the stencil ones are the fallback)
+    depthBufferFormat = chooseSupportedFormat(
+            { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT );
+
+    VkClearValue swapChainClear{ .color = { 0.0f, 0.0f, 0.0f, 1.0f } };
+    VkClearValue colourClear{ .color = { 0.6f, 0.65f, 0.4f, 1.0f } };
+    VkClearValue depthClear{ .depthStencil = { 1.0f, 0 } };
+
+    swapChainAttachment = renderGraph.importSwapChain("swapchain", swapChainImageFormat_, swapChainClear);
+    colourAttachment = renderGraph.createAttachment("colour", colourBufferFormat, false, true, colourClear);
+    depthAttachment = renderGraph.createAttachment("depth", depthBufferFormat, true, true, depthClear);
+
+    // PASSES
+    // Depth only pre-pass, the scene pass then shades each pixel once
+    depthPrePassPass = renderGraph.addPass("depth prepass");
+    renderGraph.writeDepth(depthPrePassPass, depthAttachment);
+
+    // Scene into the intermediate colour and depth attachments
+    scenePass = renderGraph.addPass("scene");
+    renderGraph.writeColour(scenePass, colourAttachment);
+    renderGraph.writeDepth(scenePass, depthAttachment);
+
+    // Post process reads both as input attachments and writes the swap chain image
+    postProcessPass = renderGraph.addPass("post process");
+    renderGraph.readInput(postProcessPass, colourAttachment);
+    renderGraph.readInput(postProcessPass, depthAttachment);
+    renderGraph.writeColour(postProcessPass, swapChainAttachment);
+
+    // Subpasses, layouts, load/store ops and dependencies all follow from the uses above
+    renderPass_ = renderGraph.compile(device_.logicalDevice);
 }
 
 void VulkanRenderer::createDescriptorSetLayout() {
@@ -874,21 +1375,22 @@ void VulkanRenderer::createDescriptorSetLayout() {
     // VP Binding info
     VkDescriptorSetLayoutBinding vpLayoutBinding{};
     vpLayoutBinding.binding = 0; // Binding point in shader (designated by binding number in shader)
-    vpLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Type of descriptor (uniform, dynamic uniform, image sampler, etc)
+    vpLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; // Type of descriptor (uniform, dynamic uniform, image sampler, etc)
     vpLayoutBinding.descriptorCount = 1; // Number of descriptors for binding
     vpLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // Shader stage to bind to
     vpLayoutBinding.pImmutableSamplers = nullptr; // For Texture: Can make sampler data unchangeable (immutable) by specifying in layout
 
-    // Model Binding Info
-//    VkDescriptorSetLayoutBinding modelLayoutBinding{};
-//    modelLayoutBinding.binding = 1;
-//    modelLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-//    modelLayoutBinding.descriptorCount = 1;
-//    modelLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-//    modelLayoutBinding.pImmutableSamplers = nullptr;
+    // Object Binding Info (model and MVP of every object, indexed by the instance index of its draws)
+    VkDescriptorSetLayoutBinding objectLayoutBinding{};
+    objectLayoutBinding.binding = 1;
+    objectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    objectLayoutBinding.descriptorCount = 1;
+    objectLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    objectLayoutBinding.pImmutableSamplers = nullptr;
 
     std::vector<VkDescriptorSetLayoutBinding> layoutBindings{
-            vpLayoutBinding
+            vpLayoutBinding,
+            objectLayoutBinding
     };
 
     // Create Descriptor Set Layout with given bindings
@@ -910,7 +1412,7 @@ void VulkanRenderer::createDescriptorSetLayout() {
     VkDescriptorSetLayoutBinding samplerLayoutBinding{};
     samplerLayoutBinding.binding = 0;
     samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLayoutBinding.descriptorCount = 1;
+    samplerLayoutBinding.descriptorCount = bindlessTextures ? maxBindlessTextures : 1;
     samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     samplerLayoutBinding.pImmutableSamplers = nullptr;
 
@@ -920,6 +1422,22 @@ void VulkanRenderer::createDescriptorSetLayout() {
     textureLayoutCreateInfo.bindingCount = 1;
     textureLayoutCreateInfo.pBindings = &samplerLayoutBinding;
 
+    // Bindless array only has the slots of loaded textures written, the rest are never read
+    // Slots are written while frames that bound the set are pending, never one those frames read
+    VkDescriptorBindingFlags samplerBindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                                   VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                                   VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo{};
+    bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsCreateInfo.bindingCount = 1;
+    bindingFlagsCreateInfo.pBindingFlags = &samplerBindingFlags;
+
+    if (bindlessTextures) {
+        textureLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        textureLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+    }
+
     // Create Descriptor Set Layout
     result = vkCreateDescriptorSetLayout(device_.logicalDevice, &textureLayoutCreateInfo, nullptr, &samplerSetLayout);
 
@@ -958,75 +1476,30 @@ void VulkanRenderer::createDescriptorSetLayout() {
 
 void VulkanRenderer::createPushConstantRange() {
     // Define push constant values (no 'create' needed)
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // shader stage push constant will go to
-    pushConstantRange.offset = 0; // Offset into given data to pass to push constant
-    pushConstantRange.size = sizeof(Model); // size of data being pass
-}
+    // Texture index into the bindless array (the model matrices come from the object buffer)
+    VkPushConstantRange materialPushConstantRange{};
+    materialPushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT; // shader stage push constant will go to
+    materialPushConstantRange.offset = 0; // Offset into given data to pass to push constant
+    materialPushConstantRange.size = sizeof(uint32_t); // size of data being pass
 
-void VulkanRenderer::createColourBufferImage() {
-    // Resize supported format for colour attachment
-    colourBufferImages.resize(swapChainImages_.size());
-    colourBufferImageView.resize(swapChainImages_.size());
-    colourBufferImageMemory.resize(swapChainImages_.size());
-
-    // Get supported format for colour attachment
-    VkFormat colourFormat = chooseSupportedFormat(
-            { VK_FORMAT_R8G8B8A8_UNORM },
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-            );
-
-    for (size_t i = 0; i < swapChainImages_.size(); ++i) {
-        // Create Colour Buffer Image
-        colourBufferImages[i] = createImage(swapChainExtent_.width, swapChainExtent_.height,
-                                            colourFormat,
-                                            VK_IMAGE_TILING_OPTIMAL,
-                                            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                            &colourBufferImageMemory[i]);
-
-        // Create Colour Image View
-        colourBufferImageView[i] = createImageView(colourBufferImages[i], colourFormat, VK_IMAGE_ASPECT_COLOR_BIT);
-    }
+    pushConstantRanges = { materialPushConstantRange };
 }
 
-void VulkanRenderer::createDepthBufferImage() {
-    depthBufferImages.resize(swapChainImages_.size());
-    depthBufferImageView.resize(swapChainImages_.size());
-    depthBufferImageMemory.resize(swapChainImages_.size());
-
-    // Get supported format for depth buffer
-    VkFormat depthForamt = chooseSupportedFormat(
-            { VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT },
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT );
-
-
-    for (size_t i = 0; i < swapChainImages_.size(); ++i) {
-        // Create depth buffer image
-        depthBufferImages[i] = createImage(swapChainExtent_.width, swapChainExtent_.height,
-                                       depthForamt,
-                                       VK_IMAGE_TILING_OPTIMAL,
-                                       VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                       &depthBufferImageMemory[i]);
-
-        // Create Depth Buffer Image View
-        depthBufferImageView[i] = createImageView(depthBufferImages[i], depthForamt, VK_IMAGE_ASPECT_DEPTH_BIT);
-    }
+void VulkanRenderer::createAttachmentImages() {
+    // Only frames that overlap on the GPU need their own, so one set per frame in flight rather than per swap chain image
+    attachmentImages = renderGraph.createImages(device_.physicalDevice, device_.logicalDevice, swapChainExtent_,
+                                                framesInFlight);
 }
 
 void VulkanRenderer::createFramebuffers() {
-    // Resize framebuffer count to equal swap chain image count
-    swapChainFramebuffers_.resize(swapChainImages_.size());
+    // One framebuffer for each pair of frame in flight and swap chain image, indexed frame * images + image
+    size_t imageCount = swapChainImages_.size();
+    swapChainFramebuffers_.resize(framesInFlight * imageCount);
 
-    // Create a framebuffer for each swap chain image
     for (size_t i = 0; i < swapChainFramebuffers_.size(); i++) {
-        std::array<VkImageView, 3> attachments = {
-                swapChainImages_[i].imageView,
-                colourBufferImageView[i],
-                depthBufferImageView[i]
-        };
+        // In render graph attachment order
+        std::vector<VkImageView> attachments = renderGraph.getFramebufferAttachments(
+                attachmentImages, static_cast<uint32_t>(i / imageCount), swapChainImages_[i % imageCount].imageView);
 
         VkFramebufferCreateInfo framebufferCreateInfo{
             .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
@@ -1065,213 +1538,210 @@ void VulkanRenderer::createCommandPool() {
 }
 
 void VulkanRenderer::createCommandBuffers() {
-    // Resize command buffer count to have 1 for each framebuffer
-    commandBuffers_.resize(swapChainFramebuffers_.size());
+    // Each frame records from its own pool, reset in one go once the frame has finished instead of per buffer
+    QueueFamilyIndices queueFamilyIndices = getQueueFamilies(device_.physicalDevice);
 
-    VkCommandBufferAllocateInfo commandBufferAllocateInfo{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = graphicsCommandPool,
-        .commandBufferCount = static_cast<uint32_t>(commandBuffers_.size())
+    VkCommandPoolCreateInfo commandPoolCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value()
     };
 
-    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;  // VK_COMMAND_BUFFER_LEVEL_PRIMARY : Buffer you submit directly to queue. Cant be called by another buffers.
-                                                                        // VK_COMMAND_BUFFER_LEVEL_SECONDARY : Buffer cant be called directly. Can be called from other buffers via "vkCmdExecuteCommands" when recording commands in primary buffer
+    for (auto& frame : frames) {
+        VkResult result = vkCreateCommandPool(device_.logicalDevice, &commandPoolCreateInfo, nullptr, &frame.commandPool);
 
-    VkResult result = vkAllocateCommandBuffers(device_.logicalDevice, &commandBufferAllocateInfo, commandBuffers_.data());
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create a Command Pool");
+        }
 
-    if (result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate Command Buffers");
+        VkCommandBufferAllocateInfo commandBufferAllocateInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = frame.commandPool,
+            .commandBufferCount = 1
+        };
+
+        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;  // VK_COMMAND_BUFFER_LEVEL_PRIMARY : Buffer you submit directly to queue. Cant be called by another buffers.
+                                                                            // VK_COMMAND_BUFFER_LEVEL_SECONDARY : Buffer cant be called directly. Can be called from other buffers via "vkCmdExecuteCommands" when recording commands in primary buffer
+
+        result = vkAllocateCommandBuffers(device_.logicalDevice, &commandBufferAllocateInfo, &frame.commandBuffer);
+
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate Command Buffers");
+        }
     }
 }
 
 void VulkanRenderer::createSynchronisation() {
-    imageAvailable.resize(MAX_FRAME_DRAWS);
-    renderFinished.resize(MAX_FRAME_DRAWS);
-    drawFences.resize(MAX_FRAME_DRAWS);
-
     // Semaphore creation information
     VkSemaphoreCreateInfo semaphoreCreateInfo{
             .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
     };
 
-    VkFenceCreateInfo fenceCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .flags = VK_FENCE_CREATE_SIGNALED_BIT
-    };
-
-    for (size_t i = 0; i < MAX_FRAME_DRAWS; i++) {
-        if (vkCreateSemaphore(device_.logicalDevice, &semaphoreCreateInfo, nullptr, &imageAvailable[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device_.logicalDevice, &semaphoreCreateInfo, nullptr, &renderFinished[i]) != VK_SUCCESS ||
-            vkCreateFence(device_.logicalDevice, &fenceCreateInfo, nullptr, &drawFences[i]) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create a Semaphore and/or Fence");
+    for (auto& frame : frames) {
+        if (vkCreateSemaphore(device_.logicalDevice, &semaphoreCreateInfo, nullptr, &frame.imageAvailable) != VK_SUCCESS ||
+            vkCreateSemaphore(device_.logicalDevice, &semaphoreCreateInfo, nullptr, &frame.renderFinished) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create a Semaphore");
         }
     }
 }
 
 void VulkanRenderer::createUniformBuffers() {
-    // ViewProjection buffer size
-    VkDeviceSize vpBufferSize = sizeof(UboViewProjection);
+    // ViewProjection slice size, every frame in flight writes its own slice of the one buffer
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device_.physicalDevice, &deviceProperties);
 
-    // Model buffer size
-//    VkDeviceSize modelBufferSize = modelUniformAlignment * MAX_OBJECTS;
+    VkDeviceSize alignment = deviceProperties.limits.minUniformBufferOffsetAlignment;
+    vpUniformStride = (sizeof(UboViewProjection) + alignment - 1) & ~(alignment - 1);
 
-    // One uniform buffer for each image (and by extension, command buffer)
-    vpUniformBuffer.resize(swapChainImages_.size());
-    vpUniformBufferMemory.resize(swapChainImages_.size());
+    // Device local too on integrated GPUs/resizable BAR, so shaders don't read it across the bus
+    createBuffer(device_.physicalDevice, device_.logicalDevice, vpUniformStride * frames.size(),
+                 VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, getHostWriteMemoryFlags(device_.physicalDevice),
+                 &vpUniformBuffer, &vpUniformBufferMemory, MemoryCategory::UNIFORM);
 
-    modelDUniformBuffer.resize(swapChainImages_.size());
-    modelDUniformBufferMemory.resize(swapChainImages_.size());
+    // Stays mapped, each frame only writes its slice
+    vkMapMemory(device_.logicalDevice, vpUniformBufferMemory, 0, VK_WHOLE_SIZE, 0, &vpUniformData);
 
-    // Create Uniform buffers
-    for (size_t i = 0; i < swapChainImages_.size(); ++i) {
-        createBuffer(device_.physicalDevice, device_.logicalDevice, vpBufferSize,
-                     VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     &vpUniformBuffer[i], &vpUniformBufferMemory[i]);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        frames[i].uniformOffset = vpUniformStride * i;
+    }
+}
 
-//        createBuffer(device_.physicalDevice, device_.logicalDevice, modelBufferSize,
-//                     VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-//                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-//                     &modelDUniformBuffer[i], &modelDUniformBufferMemory[i]);
+void VulkanRenderer::createFrameContexts() {
+    frames.resize(framesInFlight);
+
+    createCommandBuffers();
+    createSynchronisation();
+    createUniformBuffers();
+
+    // Transient sets, reset in bulk once their frame has finished on the GPU
+    for (auto& frame : frames) {
+        frame.descriptorAllocator.init(device_.logicalDevice, DESCRIPTOR_POOL_SETS,
+                                       { { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 2.0f } });
     }
 }
 
-void VulkanRenderer::createDescriptorPool() {
-    // CREATE UNIFORM DESCRIPTOR POOL
-    // Type of descriptors + how many DESCRIPTORS, not Descriptor Sets (combined makes the pool size)
-    // ViewProjectionPool
-    VkDescriptorPoolSize vpPoolSize{};
-    vpPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    vpPoolSize.descriptorCount = static_cast<uint32_t>(vpUniformBuffer.size());
-
-    // Model Pool (DYNAMIC)
-//    VkDescriptorPoolSize modelPoolSize{};
-//    modelPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-//    modelPoolSize.descriptorCount = static_cast<uint32_t>(modelDUniformBuffer.size());
-
-    std::vector<VkDescriptorPoolSize> descriptorPoolSizes{
-        vpPoolSize,
-    };
+void VulkanRenderer::destroyFrameContexts() {
+    for (auto& frame : frames) {
+        frame.descriptorAllocator.clean();
 
-    // Data to create Descriptor Pool
-    VkDescriptorPoolCreateInfo poolCreateInfo{};
-    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolCreateInfo.maxSets = static_cast<uint32_t>(swapChainImages_.size()); // Maximum number of Descriptor Sets that can be created from pool
-    poolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size()); // Amount of Pool Sizes being passed
-    poolCreateInfo.pPoolSizes = descriptorPoolSizes.data(); // Pool Sizes to create pool with
+        for (const auto& range : frame.vacatedGeometry) {
+            geometryHeap.releaseRange(range);
+        }
 
-    // Create Descriptor Pool
-    VkResult result = vkCreateDescriptorPool(device_.logicalDevice, &poolCreateInfo, nullptr, &descriptorPool);
+        vkDestroySemaphore(device_.logicalDevice, frame.renderFinished, nullptr);
+        vkDestroySemaphore(device_.logicalDevice, frame.imageAvailable, nullptr);
 
-    if (result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create a Descriptor Pool");
+        // Frees its command buffer with it
+        vkDestroyCommandPool(device_.logicalDevice, frame.commandPool, nullptr);
     }
 
-    // CREATE SAMPLER DESCRIPTOR POOL
-    // Texture sampler pool
+    frames.clear();
+
+    vkUnmapMemory(device_.logicalDevice, vpUniformBufferMemory);
+    vkDestroyBuffer(device_.logicalDevice, vpUniformBuffer, nullptr);
+    freeMemory(device_.logicalDevice, vpUniformBufferMemory);
+
+    vpUniformData = nullptr;
+}
+
+void VulkanRenderer::createDescriptorPool() {
+    // CREATE DESCRIPTOR ALLOCATORS
+    // Type of descriptors + how many per set (combined with the sets per pool makes each pool size)
+    // Pools are chained as they fill up, so models with any number of textures can be loaded
+    descriptorPoolRatios = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f }, // ViewProjection
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f }, // Object records
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f }, // Textures (when not bindless)
+    };
+
+    // Sets that live as long as the renderer (the frame allocators are created with the frames)
+    descriptorAllocator.init(device_.logicalDevice, DESCRIPTOR_POOL_SETS, descriptorPoolRatios);
+
+    if (!bindlessTextures) return;
+
+    // CREATE BINDLESS SAMPLER DESCRIPTOR POOL
+    // Holds the one set with the whole texture array, sized once from the device limits
     VkDescriptorPoolSize samplerPoolSizer{};
     samplerPoolSizer.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerPoolSizer.descriptorCount = MAX_OBJECTS;
+    samplerPoolSizer.descriptorCount = maxBindlessTextures;
 
     VkDescriptorPoolCreateInfo samplerPoolCreateInfo{};
     samplerPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    samplerPoolCreateInfo.maxSets = MAX_OBJECTS;
+    samplerPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT; // Layout is update after bind
+    samplerPoolCreateInfo.maxSets = 1;
     samplerPoolCreateInfo.poolSizeCount = 1;
     samplerPoolCreateInfo.pPoolSizes = &samplerPoolSizer;
 
-    result = vkCreateDescriptorPool(device_.logicalDevice, &samplerPoolCreateInfo, nullptr, &samplerDescriptorPool);
+    VkResult result = vkCreateDescriptorPool(device_.logicalDevice, &samplerPoolCreateInfo, nullptr, &samplerDescriptorPool);
 
     if (result != VK_SUCCESS) throw std::runtime_error("Failed to create a Descriptor Pool");
-
-    // CREATE INPUT ATTACHMENT DESCRIPTOR POOL
-    // Colour Attachment Pool Size
-    VkDescriptorPoolSize colourInputPoolSize = {};
-    colourInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-    colourInputPoolSize.descriptorCount = static_cast<uint32_t>(colourBufferImageView.size());
-
-    // Depth Attachment Pool Size
-    VkDescriptorPoolSize depthInputPoolSize = {};
-    depthInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-    depthInputPoolSize.descriptorCount = static_cast<uint32_t>(depthBufferImageView.size());
-
-    std::vector<VkDescriptorPoolSize> inputPoolSizes = { colourInputPoolSize, depthInputPoolSize };
-
-    // Create input attachment pool
-    VkDescriptorPoolCreateInfo inputPoolCreateInfo = {};
-    inputPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    inputPoolCreateInfo.maxSets = swapChainImages_.size();
-    inputPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(inputPoolSizes.size());
-    inputPoolCreateInfo.pPoolSizes = inputPoolSizes.data();
-
-    result = vkCreateDescriptorPool(device_.logicalDevice, &inputPoolCreateInfo, nullptr, &inputDescriptorPool);
-    if (result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create a Descriptor Pool!");
-    }
 }
 
 void VulkanRenderer::createDescriptorSets() {
-    // Resize Descriptor Set list so one for every buffer
-    descriptorSets.resize(swapChainImages_.size());
-
-    std::vector<VkDescriptorSetLayout> setLayouts(swapChainImages_.size(), descriptorSetLayout);
-
-    // Descriptor Set Allocation Info
-    VkDescriptorSetAllocateInfo setAllocInfo{};
-    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    setAllocInfo.descriptorPool = descriptorPool; // Pool to allocate Descriptor Set from
-    setAllocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages_.size()); // Number of sets to allocate
-    setAllocInfo.pSetLayouts = setLayouts.data(); // Layouts to use to allocate sets (1:1 relationship)
-
-    // Allocate descriptor sets (multiple)
-    VkResult result = vkAllocateDescriptorSets(device_.logicalDevice, &setAllocInfo, descriptorSets.data());
-
-    if (result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate Descriptor Sets");
+    // One set for every frame, the dynamic offset picks the slice of the frame when it is bound
+    // (rewritten when the frames, and with them the buffer, are recreated, reallocated when the object buffer grows)
+    if (!vpDescriptorSet && !freeVpDescriptorSets.empty()) {
+        vpDescriptorSet = freeVpDescriptorSets.back();
+        freeVpDescriptorSets.pop_back();
     }
 
-    // Update all of descriptor set buffer bindings
-    for (size_t i = 0; i < swapChainImages_.size(); ++i) {
+    if (!vpDescriptorSet) vpDescriptorSet = descriptorAllocator.allocate(descriptorSetLayout);
+
+    {
         // VIEWPROJECTIOON DESCRIPTOR
         // Buffer info and data offset info
         VkDescriptorBufferInfo vpBufferInfo{};
-        vpBufferInfo.buffer = vpUniformBuffer[i]; // Buffer to get data from
-        vpBufferInfo.offset = 0; // Position of start of data
+        vpBufferInfo.buffer = vpUniformBuffer; // Buffer to get data from
+        vpBufferInfo.offset = 0; // Position of start of data (plus the dynamic offset)
         vpBufferInfo.range = sizeof(UboViewProjection); // Size of data
 
         // Data about connection between binding and buffer
         VkWriteDescriptorSet vpSetWrite{};
         vpSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        vpSetWrite.dstSet = descriptorSets[i];	// Descriptor Set to update
+        vpSetWrite.dstSet = vpDescriptorSet;	// Descriptor Set to update
         vpSetWrite.dstBinding = 0;	// Binding to update (matches with binding on layout/shader)
         vpSetWrite.dstArrayElement = 0; // Index in array to update
-        vpSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Type of descriptor
+        vpSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; // Type of descriptor
         vpSetWrite.descriptorCount = 1; // Amount to update
         vpSetWrite.pBufferInfo = &vpBufferInfo; // Information about buffer data to bind
 
-        // MODEL DESCRIPTOR
-//        VkDescriptorBufferInfo modelBufferInfo{};
-//        modelBufferInfo.buffer = modelDUniformBuffer[i];
-//        modelBufferInfo.offset = 0;
-//        modelBufferInfo.range = modelUniformAlignment;
-//
-//        VkWriteDescriptorSet modelSetWrite{};
-//        modelSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-//        modelSetWrite.dstSet = descriptorSets[i];
-//        modelSetWrite.dstBinding = 1;
-//        modelSetWrite.dstArrayElement = 0;
-//        modelSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-//        modelSetWrite.descriptorCount = 1;
-//        modelSetWrite.pBufferInfo = &modelBufferInfo;
+        // OBJECT DESCRIPTOR
+        VkDescriptorBufferInfo objectBufferInfo{};
+        objectBufferInfo.buffer = objectBuffer;
+        objectBufferInfo.offset = 0;
+        objectBufferInfo.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet objectSetWrite{};
+        objectSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        objectSetWrite.dstSet = vpDescriptorSet;
+        objectSetWrite.dstBinding = 1;
+        objectSetWrite.dstArrayElement = 0;
+        objectSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        objectSetWrite.descriptorCount = 1;
+        objectSetWrite.pBufferInfo = &objectBufferInfo;
 
         std::vector<VkWriteDescriptorSet> setWrites{
-                vpSetWrite
+                vpSetWrite,
+                objectSetWrite
         };
 
         // Update the descriptor sets with new buffer/binding info
         vkUpdateDescriptorSets(device_.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(),
                                0, nullptr);
     }
+
+    if (bindlessTextures && !bindlessDescriptorSet) {
+        // The one texture set, textures are written into it as they are loaded
+        VkDescriptorSetAllocateInfo samplerAllocInfo{};
+        samplerAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        samplerAllocInfo.descriptorPool = samplerDescriptorPool;
+        samplerAllocInfo.descriptorSetCount = 1;
+        samplerAllocInfo.pSetLayouts = &samplerSetLayout;
+
+        VkResult result = vkAllocateDescriptorSets(device_.logicalDevice, &samplerAllocInfo, &bindlessDescriptorSet);
+
+        if (result != VK_SUCCESS) throw std::runtime_error("Failed to allocate the Bindless Texture Descriptor Set");
+    }
 }
 
 void VulkanRenderer::createTextureSampler() {
@@ -1288,7 +1758,7 @@ void VulkanRenderer::createTextureSampler() {
     samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR; // Mipmap interpolation mode
     samplerCreateInfo.mipLodBias = 0.0f; // Level of details bias for mip level
     samplerCreateInfo.minLod = 0.0f; // Minimum Level of Detail to pick mip level
-    samplerCreateInfo.maxLod = 0.0f; // Maximum Level of Detail to pick mip level
+    samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE; // Maximum Level of Detail to pick mip level (each image view limits its own chain)
     samplerCreateInfo.anisotropyEnable = VK_TRUE; // Enable Anisotropy
     samplerCreateInfo.maxAnisotropy = 16; // Anisotropy sample level
 
@@ -1297,95 +1767,166 @@ void VulkanRenderer::createTextureSampler() {
     if (result != VK_SUCCESS) throw std::runtime_error("Failed to crate a Texture Sampler");
 }
 
-void VulkanRenderer::createInputDescriptorSets() {
-    // Resize array to hold descriptor set for each swap chain image
-    inputDescriptorSets.resize(swapChainImages_.size());
+void VulkanRenderer::updateUniformBuffers(const FrameContext& frame) {
+    // Copy VP data into the slice of the frame (the GPU is done with it, the frame's fence was waited on)
+    memcpy(static_cast<char*>(vpUniformData) + frame.uniformOffset, &uboViewProjection, sizeof(UboViewProjection));
+}
+
+void VulkanRenderer::createObjectBuffers(uint32_t capacity) {
+    // Frames in flight may still read the old buffers, they go once those have finished
+    if (objectBuffer) {
+        vkUnmapMemory(device_.logicalDevice, objectStagingBufferMemory);
+
+        deletionQueue.push(graphicsTimeline.getSubmittedValue(),
+                           [this, buffer = objectBuffer, memory = objectBufferMemory,
+                            stagingBuffer = objectStagingBuffer, stagingMemory = objectStagingBufferMemory] {
+            vkDestroyBuffer(device_.logicalDevice, buffer, nullptr);
+            freeMemory(device_.logicalDevice, memory);
+            vkDestroyBuffer(device_.logicalDevice, stagingBuffer, nullptr);
+            freeMemory(device_.logicalDevice, stagingMemory);
+        });
+    }
+
+    objectCapacity = capacity;
+    VkDeviceSize bufferSize = sizeof(ObjectData) * capacity;
 
-    // Fill array of layouts ready for set creation
-    std::vector<VkDescriptorSetLayout> setLayouts(swapChainImages_.size(), inputSetLayout);
+    // Read by every draw, so device local and only written by copies
+    createBuffer(device_.physicalDevice, device_.logicalDevice, bufferSize,
+                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &objectBuffer, &objectBufferMemory, MemoryCategory::UNIFORM);
 
-    // Input Attachment Descriptor Set Allocation Info
-    VkDescriptorSetAllocateInfo setAllocInfo = {};
-    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    setAllocInfo.descriptorPool = inputDescriptorPool;
-    setAllocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages_.size());
-    setAllocInfo.pSetLayouts = setLayouts.data();
+    // A slice per frame in flight, big enough for every record to be dirty at once (camera moved)
+    createBuffer(device_.physicalDevice, device_.logicalDevice, bufferSize * frames.size(),
+                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT, getHostWriteMemoryFlags(device_.physicalDevice),
+                 &objectStagingBuffer, &objectStagingBufferMemory, MemoryCategory::STAGING);
 
-    // Allocate Descriptor Sets
-    VkResult result = vkAllocateDescriptorSets(device_.logicalDevice, &setAllocInfo, inputDescriptorSets.data());
-    if (result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to allocate Input Attachment Descriptor Sets!");
+    vkMapMemory(device_.logicalDevice, objectStagingBufferMemory, 0, VK_WHOLE_SIZE, 0, &objectStagingData);
+
+    for (size_t i = 0; i < frames.size(); ++i) {
+        frames[i].objectStagingOffset = bufferSize * i;
     }
 
-    // Update each descriptor set with input attachment
-    for (size_t i = 0; i < swapChainImages_.size(); i++)
-    {
-        // Colour Attachment Descriptor
-        VkDescriptorImageInfo colourAttachmentDescriptor = {};
-        colourAttachmentDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        colourAttachmentDescriptor.imageView = colourBufferImageView[i];
-        colourAttachmentDescriptor.sampler = VK_NULL_HANDLE;
-
-        // Colour Attachment Descriptor Write
-        VkWriteDescriptorSet colourWrite = {};
-        colourWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        colourWrite.dstSet = inputDescriptorSets[i];
-        colourWrite.dstBinding = 0;
-        colourWrite.dstArrayElement = 0;
-        colourWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-        colourWrite.descriptorCount = 1;
-        colourWrite.pImageInfo = &colourAttachmentDescriptor;
-
-        // Depth Attachment Descriptor
-        VkDescriptorImageInfo depthAttachmentDescriptor = {};
-        depthAttachmentDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        depthAttachmentDescriptor.imageView = depthBufferImageView[i];
-        depthAttachmentDescriptor.sampler = VK_NULL_HANDLE;
-
-        // Depth Attachment Descriptor Write
-        VkWriteDescriptorSet depthWrite = {};
-        depthWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        depthWrite.dstSet = inputDescriptorSets[i];
-        depthWrite.dstBinding = 1;
-        depthWrite.dstArrayElement = 0;
-        depthWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-        depthWrite.descriptorCount = 1;
-        depthWrite.pImageInfo = &depthAttachmentDescriptor;
-
-        // List of input descriptor set writes
-        std::vector<VkWriteDescriptorSet> setWrites = { colourWrite, depthWrite };
-
-        // Update descriptor sets
-        vkUpdateDescriptorSets(device_.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
-    }
-}
-
-void VulkanRenderer::updateUniformBuffers(uint32_t imageIndex) {
-    // Copy VP data
-    void* data;
-    vkMapMemory(device_.logicalDevice, vpUniformBufferMemory[imageIndex], 0, sizeof(UboViewProjection),
-                0, &data);
-    memcpy(data, &uboViewProjection, sizeof(UboViewProjection));
-    vkUnmapMemory(device_.logicalDevice, vpUniformBufferMemory[imageIndex]);
-
-    // Copy Model data
-    /*for (size_t i = 0; i < meshList.size(); ++i) {
-        auto* model_ = (UboModel*)((uint64_t)modelTransferSpace + (i * modelUniformAlignment));
-        *model_ = meshList[i].getUboModel();
-    }
-
-    // Map the list of model_ data
-    vkMapMemory(device_.logicalDevice, modelDUniformBufferMemory[imageIndex], 0,
-                modelUniformAlignment * meshList.size(), 0, &data);
-    memcpy(data, modelTransferSpace, modelUniformAlignment * meshList.size());
-    vkUnmapMemory(device_.logicalDevice, modelDUniformBufferMemory[imageIndex]); */
-}
-
-void VulkanRenderer::recordCommands(uint32_t currentImage) {
-    // Information about how to begin each command buffer
+    // New buffer starts empty, every live record is uploaded again
+    for (uint32_t j = 0; j < modelList.size(); ++j) {
+        markObjectDirty(modelList.getSlot(j));
+    }
+}
+
+void VulkanRenderer::destroyObjectBuffers() {
+    vkUnmapMemory(device_.logicalDevice, objectStagingBufferMemory);
+    vkDestroyBuffer(device_.logicalDevice, objectStagingBuffer, nullptr);
+    freeMemory(device_.logicalDevice, objectStagingBufferMemory);
+    vkDestroyBuffer(device_.logicalDevice, objectBuffer, nullptr);
+    freeMemory(device_.logicalDevice, objectBufferMemory);
+
+    objectStagingData = nullptr;
+    objectBuffer = VK_NULL_HANDLE;
+}
+
+void VulkanRenderer::markObjectDirty(uint32_t objectIndex) {
+    if (objectDirty[objectIndex]) return;
+
+    objectDirty[objectIndex] = true;
+    dirtyObjects.push_back(objectIndex);
+}
+
+void VulkanRenderer::recordObjectUpload(const FrameContext& frame, VkCommandBuffer commandBuffer) {
+    // Every record has the camera multiplied in, so moving it dirties them all
+    glm::mat4 viewProjection = uboViewProjection.projection * uboViewProjection.view;
+
+    if (viewProjection != objectViewProjection) {
+        objectViewProjection = viewProjection;
+
+        for (uint32_t j = 0; j < modelList.size(); ++j) {
+            markObjectDirty(modelList.getSlot(j));
+        }
+    }
+
+    if (dirtyObjects.empty()) return;
+
+    // More slots than records: double until they fit, the old set stays bound by the frames in flight so get a new one
+    if (objectData.size() > objectCapacity) {
+        uint32_t capacity = objectCapacity;
+
+        while (capacity < objectData.size()) capacity *= 2;
+
+        spdlog::info("[Vulkan-Renderer] Object buffer grows to {} records", capacity);
+
+        createObjectBuffers(capacity);
+
+        // Sets can't be freed one by one, the old one is reused by the next growth once its frames have finished
+        deletionQueue.push(graphicsTimeline.getSubmittedValue(), [this, set = vpDescriptorSet] {
+            freeVpDescriptorSets.push_back(set);
+        });
+
+        vpDescriptorSet = VK_NULL_HANDLE;
+        createDescriptorSets();
+    }
+
+    // Runs of consecutive dirty records become one copy each
+    std::sort(dirtyObjects.begin(), dirtyObjects.end());
+
+    auto* staging = static_cast<char*>(objectStagingData) + frame.objectStagingOffset;
+    VkDeviceSize stagingSize = 0;
+    std::vector<VkBufferCopy> copyRegions;
+
+    for (size_t i = 0; i < dirtyObjects.size();) {
+        size_t runEnd = i + 1;
+
+        while (runEnd < dirtyObjects.size() && dirtyObjects[runEnd] == dirtyObjects[runEnd - 1] + 1) ++runEnd;
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = frame.objectStagingOffset + stagingSize;
+        copyRegion.dstOffset = sizeof(ObjectData) * dirtyObjects[i];
+        copyRegion.size = sizeof(ObjectData) * (runEnd - i);
+
+        for (; i < runEnd; ++i) {
+            ObjectData& object = objectData[dirtyObjects[i]];
+            object.modelViewProjection = objectViewProjection * object.model;
+
+            memcpy(staging + stagingSize, &object, sizeof(ObjectData));
+            stagingSize += sizeof(ObjectData);
+
+            objectDirty[dirtyObjects[i]] = false;
+        }
+
+        copyRegions.push_back(copyRegion);
+    }
+
+    dirtyObjects.clear();
+
+    // The previous frame's vertex shaders may still read the records about to be overwritten (execution dependency only)
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    vkCmdCopyBuffer(commandBuffer, objectStagingBuffer, objectBuffer, static_cast<uint32_t>(copyRegions.size()),
+                    copyRegions.data());
+
+    // Copies have to be visible to the vertex shaders of this frame
+    VkBufferMemoryBarrier objectBarrier{};
+    objectBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    objectBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    objectBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    objectBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    objectBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    objectBarrier.buffer = objectBuffer;
+    objectBarrier.offset = 0;
+    objectBarrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                         0, 0, nullptr, 1, &objectBarrier, 0, nullptr);
+}
+
+void VulkanRenderer::recordCommands(FrameContext& frame, uint32_t currentImage) {
+    VkCommandBuffer commandBuffer = frame.commandBuffer;
+
+    // Slice of the ViewProjection buffer this frame reads
+    auto vpOffset = static_cast<uint32_t>(frame.uniformOffset);
+
+    // Information about how to begin each command buffer (recorded fresh every frame)
     VkCommandBufferBeginInfo bufferBeginInfo = {};
     bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     // Information about how to begin a render pass (only needed for graphical applications)
     VkRenderPassBeginInfo renderPassBeginInfo = {};
@@ -1394,86 +1935,241 @@ void VulkanRenderer::recordCommands(uint32_t currentImage) {
     renderPassBeginInfo.renderArea.offset = { 0, 0 };						// Start point of render pass in pixels
     renderPassBeginInfo.renderArea.extent = swapChainExtent_;				// Size of region to run render pass on (starting at offset)
 
-    std::array<VkClearValue, 3> clearValues = {};
-    clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-    clearValues[1].color = { 0.6f, 0.65f, 0.4f, 1.0f };
-    clearValues[2].depthStencil.depth = 1.0f;
+    // One per attachment, in render graph order
+    std::vector<VkClearValue> clearValues = renderGraph.getClearValues();
 
     renderPassBeginInfo.pClearValues = clearValues.data();					// List of clear values
     renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 
-    renderPassBeginInfo.framebuffer = swapChainFramebuffers_[currentImage];
+    renderPassBeginInfo.framebuffer = swapChainFramebuffers_[currentFrame * swapChainImages_.size() + currentImage];
 
     // Start recording commands to command buffer!
-    VkResult result = vkBeginCommandBuffer(commandBuffers_[currentImage], &bufferBeginInfo);
+    VkResult result = vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
 
     if (result != VK_SUCCESS) {
         throw std::runtime_error("Failed to start recording a Command Buffer!");
     }
 
-    // Begin Render Pass
-    vkCmdBeginRenderPass(commandBuffers_[currentImage], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    // Moved models (or all of them, when the camera moved) are copied into the object buffer before any draw
+    recordObjectUpload(frame, commandBuffer);
 
-        // Bind Pipeline to be used in render pass
-        vkCmdBindPipeline(commandBuffers_[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline_);
+    // Compact the mesh buffers a few at a time, the packets then have to pick up their new offsets
+    frame.vacatedGeometry = geometryHeap.defragment(commandBuffer, GEOMETRY_MOVES_PER_FRAME);
 
-        for (size_t j = 0; j < modelList.size(); j++) {
-            MeshModel thisModel = modelList[j];
+    if (!frame.vacatedGeometry.empty()) drawListDirty = true;
 
-            vkCmdPushConstants(
-                    commandBuffers_[currentImage],
-                    pipelineLayout,
-                    VK_SHADER_STAGE_VERTEX_BIT,		// Stage to push constants to
-                    0,								// Offset of push constants to update
-                    sizeof(Model),					// Size of data being pushed
-                    &thisModel.getModel());			// Actual data being pushed (can be array)
+    // Packets in state order and front to back, so the depth test rejects as much as possible
+    buildDrawList();
 
-            for (size_t k = 0; k < thisModel.getMeshCount(); k++) {
-                VkBuffer vertexBuffers[] = { thisModel.getMesh(k)->getVertexBuffer() };					// Buffers to bind
-                VkDeviceSize offsets[] = { 0 };												// Offsets into buffers being bound
-                vkCmdBindVertexBuffers(commandBuffers_[currentImage], 0, 1, vertexBuffers, offsets);	// Command to bind vertex buffer before drawing with them
-
-                // Bind mesh index buffer, with 0 offset and using the uint32 type
-                vkCmdBindIndexBuffer(commandBuffers_[currentImage], thisModel.getMesh(k)->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    // Begin Render Pass
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        // Viewport and scissor cover the current swap chain (dynamic state, kept for every subpass)
+        VkViewport viewport{
+            .x = 0.0f,
+            .y = 0.0f,
+            .width = static_cast<float>(swapChainExtent_.width),
+            .height = static_cast<float>(swapChainExtent_.height),
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f
+        };
 
-                // Dynamic Offset Amount
-                // uint32_t dynamicOffset = static_cast<uint32_t>(modelUniformAlignment) * j;
+        VkRect2D scissor{
+            .offset = {0, 0}, // Offset to use region from
+            .extent = swapChainExtent_ // Extent to describe region to use, starting on offset
+        };
 
-                // "Push" constants to given shader stage directly (no buffer)
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
+        // Depth pre-pass: positions only and no fragment shader, so depth is complete before anything is shaded
+        // (the subpass is left empty when the pre-pass is off)
+        if (depthPrePass) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPrePassPipeline);
+            recordSceneDraws(commandBuffer, pipelineLayout, true, true, vpOffset);
+        }
 
-                std::array<VkDescriptorSet, 2> descriptorSetGroup = { descriptorSets[currentImage],
-                                                                      samplerDescriptorSets[thisModel.getMesh(k)->getTextureId()] };
+        // Start scene subpass
+        vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
 
-                // Bind Descriptor Sets
-                vkCmdBindDescriptorSets(commandBuffers_[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-                                        0, static_cast<uint32_t>(descriptorSetGroup.size()), descriptorSetGroup.data(), 0, nullptr);
+        // After the pre-pass only the front most fragment of each pixel passes the EQUAL test, so the order doesn't change
+        // what gets shaded anymore: draws go in state order (fewest binds). Without it front to back saves the shading
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPrePass ? depthEqualPipeline : graphicsPipeline_);
+        recordSceneDraws(commandBuffer, pipelineLayout, false, !depthPrePass, vpOffset);
 
-                // Execute pipeline
-                vkCmdDrawIndexed(commandBuffers_[currentImage], thisModel.getMesh(k)->getIndexCount(), 1, 0, 0, 0);
-            }
-        }
+        // Start post process subpass
+        vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
 
-        // Start second subpass
-        vkCmdNextSubpass(commandBuffers_[currentImage], VK_SUBPASS_CONTENTS_INLINE);
+        VkDescriptorSet inputDescriptorSet = writeInputDescriptorSet();
 
-        vkCmdBindPipeline(commandBuffers_[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, secondPipeline);
-        vkCmdBindDescriptorSets(commandBuffers_[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, secondPipeLineLayout,
-                                0, 1, &inputDescriptorSets[currentImage], 0, nullptr);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, secondPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, secondPipeLineLayout,
+                                0, 1, &inputDescriptorSet, 0, nullptr);
 
-        vkCmdDraw(commandBuffers_[currentImage], 3, 1, 0, 0);
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 
     // End Render Pass
-    vkCmdEndRenderPass(commandBuffers_[currentImage]);
+    vkCmdEndRenderPass(commandBuffer);
+
+    // Copy the finished image out when a capture is due (read back once the frame has completed)
+    if (swapChainReadable) {
+        frameCapture.recordCopy(commandBuffer, swapChainImages_[currentImage].image, swapChainImageFormat_,
+                                swapChainExtent_);
+    }
 
     // Stop recording to command buffer
-    result = vkEndCommandBuffer(commandBuffers_[currentImage]);
+    result = vkEndCommandBuffer(commandBuffer);
 
     if (result != VK_SUCCESS) {
         throw std::runtime_error("Failed to stop recording a Command Buffer!");
     }
 }
 
+void VulkanRenderer::recordSceneDraws(VkCommandBuffer commandBuffer, VkPipelineLayout layout, bool positionsOnly,
+                                      bool depthOrder, uint32_t vpOffset) {
+    // The ViewProjection set stays bound for every draw, with bindless so does the texture set
+    if (bindlessTextures && !positionsOnly) {
+        std::array<VkDescriptorSet, 2> descriptorSetGroup = { vpDescriptorSet, bindlessDescriptorSet };
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout,
+                                0, static_cast<uint32_t>(descriptorSetGroup.size()), descriptorSetGroup.data(), 1, &vpOffset);
+    } else {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &vpDescriptorSet, 1, &vpOffset);
+    }
+
+    // Last state recorded, only what differs for the next draw is emitted
+    VkBuffer currentVertexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize currentVertexOffset = 0;
+    VkBuffer currentIndexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize currentIndexOffset = 0;
+    int currentTexture = -1;
+
+    for (size_t i = 0; i < drawPackets.size(); ++i) {
+        const DrawPacket& packet = drawPackets[depthOrder ? drawKeys[i] & 0xFFFFFFFF : i];
+
+        VkBuffer vertexBuffer = positionsOnly ? packet.positionBuffer : packet.vertexBuffer;
+        VkDeviceSize vertexOffset = positionsOnly ? packet.positionOffset : packet.vertexOffset;
+
+        if (vertexBuffer != currentVertexBuffer || vertexOffset != currentVertexOffset) {
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &vertexOffset);	// Command to bind vertex buffer before drawing with them
+
+            currentVertexBuffer = vertexBuffer;
+            currentVertexOffset = vertexOffset;
+        }
+
+        if (packet.indexBuffer != currentIndexBuffer || packet.indexOffset != currentIndexOffset) {
+            // Bind mesh index buffer, at the mesh's offset in its block and using the uint32 type
+            vkCmdBindIndexBuffer(commandBuffer, packet.indexBuffer, packet.indexOffset, VK_INDEX_TYPE_UINT32);
+
+            currentIndexBuffer = packet.indexBuffer;
+            currentIndexOffset = packet.indexOffset;
+        }
+
+        // No texture for depth
+        if (!positionsOnly && packet.textureId != currentTexture) {
+            // Descriptor the texture is sampled through this frame (streaming moves it)
+            int descriptorSlot = textureDescriptorSlots[packet.textureId];
+
+            if (bindlessTextures) {
+                // Select the texture from the bindless array
+                auto textureIndex = static_cast<uint32_t>(descriptorSlot);
+
+                vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                                   0, sizeof(uint32_t), &textureIndex);
+            } else {
+                // Set 0 stays bound, only the sampler set changes
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout,
+                                        1, 1, &samplerDescriptorSets[descriptorSlot], 0, nullptr);
+            }
+
+            currentTexture = packet.textureId;
+        }
+
+        // Execute pipeline, the first instance picks the record of the model in the object buffer
+        vkCmdDrawIndexed(commandBuffer, packet.indexCount, 1, 0, 0, packet.objectIndex);
+    }
+}
+
+void VulkanRenderer::compileDrawPackets() {
+    drawPackets.clear();
+
+    // Shared geometry has the same buffers in several models, they get the same ordinal so their draws end up together
+    // (meshes share geometry blocks, so the offset tells them apart)
+    std::map<std::pair<VkBuffer, VkDeviceSize>, uint64_t> bufferOrdinals;
+
+    for (uint32_t j = 0; j < modelList.size(); ++j) {
+        MeshModel& thisModel = modelList[j];
+
+        for (size_t k = 0; k < thisModel.getMeshCount(); ++k) {
+            Mesh* mesh = thisModel.getMesh(k);
+
+            DrawPacket packet{};
+            packet.modelIndex = j;
+            packet.objectIndex = modelList.getSlot(j);
+            packet.textureId = mesh->getTextureId();
+            packet.vertexBuffer = mesh->getVertexBuffer();
+            packet.vertexOffset = mesh->getVertexOffset();
+            packet.positionBuffer = mesh->getPositionBuffer();
+            packet.positionOffset = mesh->getPositionOffset();
+            packet.indexBuffer = mesh->getIndexBuffer();
+            packet.indexOffset = mesh->getIndexOffset();
+            packet.indexCount = static_cast<uint32_t>(mesh->getIndexCount());
+            packet.boundingSphere = mesh->getBoundingSphere();
+
+            uint64_t bufferOrdinal = bufferOrdinals.emplace(std::make_pair(packet.vertexBuffer, packet.vertexOffset),
+                                                           bufferOrdinals.size()).first->second;
+
+            // [63..60] pipeline (only the opaque scene pipeline so far), [59..36] texture, [35..12] buffers, [11..0] model
+            packet.sortKey = (static_cast<uint64_t>(packet.textureId) & 0xFFFFFF) << 36 |
+                             (bufferOrdinal & 0xFFFFFF) << 12 |
+                             (static_cast<uint64_t>(j) & 0xFFF);
+
+            drawPackets.push_back(packet);
+        }
+    }
+
+    std::sort(drawPackets.begin(), drawPackets.end(), [](const DrawPacket& a, const DrawPacket& b) {
+        return a.sortKey < b.sortKey;
+    });
+
+    drawListDirty = false;
+}
+
+void VulkanRenderer::buildDrawList() {
+    // Only adding or removing models changes the packets, moving them only changes the depth order
+    if (drawListDirty) compileDrawPackets();
+
+    drawKeys.clear();
+
+    // Model matrices are looked up once per model, not per mesh
+    uint32_t currentModel = UINT32_MAX;
+    glm::mat4 modelView{};
+    float scale = 1.0f;
+
+    for (uint32_t i = 0; i < drawPackets.size(); ++i) {
+        const DrawPacket& packet = drawPackets[i];
+
+        if (packet.modelIndex != currentModel) {
+            const glm::mat4& modelMatrix = modelList[packet.modelIndex].getModel();
+            modelView = uboViewProjection.view * modelMatrix;
+
+            // Largest axis scale keeps the bounding sphere conservative
+            scale = std::max({ glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])),
+                               glm::length(glm::vec3(modelMatrix[2])) });
+            currentModel = packet.modelIndex;
+        }
+
+        // Nearest point of the bounding sphere, quantized to 16 bits over the clip range
+        float depth = -(modelView * glm::vec4(glm::vec3(packet.boundingSphere), 1.0f)).z - packet.boundingSphere.w * scale;
+        auto key = static_cast<uint64_t>(std::clamp(depth / CAMERA_FAR_PLANE, 0.0f, 1.0f) * 65535.0f);
+
+        drawKeys.push_back(key << 32 | i);
+    }
+
+    // Only the 2 bytes of the key are sorted on, the packet index rides along in the lower half
+    radixSortKeys(drawKeys, drawKeysScratch);
+}
+
 void VulkanRenderer::getPhysicalDevice() {
     spdlog::info("[Vulkan-Renderer] Get Physical Device");
 
@@ -1566,13 +2262,25 @@ bool VulkanRenderer::checkDeviceExtensionSupport(VkPhysicalDevice device) {
 
 bool VulkanRenderer::checkDeviceSuitable(VkPhysicalDevice device) {
     // Information about the device itself (ID, name. type, vendor, etc)
-//    VkPhysicalDeviceProperties deviceProperties;
-//    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
 
     // Information about what the device can do (geo shader, tess shader, wide lines, etc)
     VkPhysicalDeviceFeatures deviceFeatures;
     vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
+    // Timeline semaphores are needed for all GPU synchronisation
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+    if (deviceProperties.apiVersion >= VK_API_VERSION_1_2) {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &timelineFeatures;
+
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+    }
+
     QueueFamilyIndices indices = getQueueFamilies(device);
     bool extensionSupported = checkDeviceExtensionSupport(device);
     bool swapChainValid = false;
@@ -1582,7 +2290,19 @@ bool VulkanRenderer::checkDeviceSuitable(VkPhysicalDevice device) {
         swapChainValid = !swapChainDetails.presentationModes.empty() && !swapChainDetails.formats.empty();
     }
 
-    return indices.isValid() && extensionSupported && swapChainValid && deviceFeatures.samplerAnisotropy;
+    return indices.isValid() && extensionSupported && swapChainValid && deviceFeatures.samplerAnisotropy &&
+           timelineFeatures.timelineSemaphore;
+}
+
+bool VulkanRenderer::checkTextureFormatSupport(VkFormat format) {
+    // Compressed formats are only reported as sampleable when the matching textureCompression* feature exists
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(device_.physicalDevice, format, &properties);
+
+    VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    return (properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
 }
 
 QueueFamilyIndices VulkanRenderer::getQueueFamilies(VkPhysicalDevice device) {
@@ -1676,10 +2396,24 @@ VkSurfaceFormatKHR VulkanRenderer::chooseBestSurfaceFormat(const std::vector<VkS
 }
 
 VkPresentModeKHR VulkanRenderer::chooseBestPresentationMode(const std::vector<VkPresentModeKHR> &presentationModes) {
-    // Look for Mailbox presentation mode
-    for (const auto& presentationMode : presentationModes) {
-        if (presentationMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return  presentationMode;
+    // Modes the policy prefers over FIFO, best first
+    std::vector<VkPresentModeKHR> preferredModes;
+
+    switch (presentPolicy) {
+        case PresentPolicy::LOW_LATENCY:
+            // Relaxed FIFO tears a late frame instead of holding it for another refresh
+            preferredModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+            break;
+        case PresentPolicy::POWER_SAVING:
+            break;
+        case PresentPolicy::UNCAPPED:
+            preferredModes = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+            break;
+    }
+
+    for (auto preferredMode : preferredModes) {
+        if (std::find(presentationModes.begin(), presentationModes.end(), preferredMode) != presentationModes.end()) {
+            return preferredMode;
         }
     }
 
@@ -1731,7 +2465,8 @@ VkFormat VulkanRenderer::chooseSupportedFormat(const std::vector<VkFormat> &form
     throw std::runtime_error("Failed to find a matching format");
 }
 
-VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) {
+VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+                                            uint32_t mipLevels) {
     VkImageViewCreateInfo viewCreateInfo{
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
         .image = image, // Image to create view for
@@ -1748,7 +2483,7 @@ VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkIm
     // Subresources allow the view to view only a part of an image
     viewCreateInfo.subresourceRange.aspectMask = aspectFlags; // Which aspect of image to view (e.g. COLOR_BIT for viewing colour)
     viewCreateInfo.subresourceRange.baseMipLevel = 0; // Start mipmap level to view from
-    viewCreateInfo.subresourceRange.levelCount = 1; // Number of mipmap levels to view
+    viewCreateInfo.subresourceRange.levelCount = mipLevels; // Number of mipmap levels to view
     viewCreateInfo.subresourceRange.baseArrayLayer = 0; // Start array level to view from
     viewCreateInfo.subresourceRange.layerCount = 1; // Number of array levels to view
 
@@ -1763,11 +2498,11 @@ VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkIm
     return imageview;
 }
 
-VkShaderModule VulkanRenderer::createShaderModule(const std::vector<char> &code) {
+VkShaderModule VulkanRenderer::createShaderModule(const std::vector<uint32_t> &code) {
     VkShaderModuleCreateInfo shaderModuleCreateInfo{
         .sType=VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .codeSize=code.size(),
-        .pCode=reinterpret_cast<const uint32_t*>(code.data())
+        .codeSize=code.size() * sizeof(uint32_t), // In bytes
+        .pCode=code.data()
     };
 
     VkShaderModule shaderModule;
@@ -1780,9 +2515,10 @@ VkShaderModule VulkanRenderer::createShaderModule(const std::vector<char> &code)
     return shaderModule;
 }
 
-VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
-                                    VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags,
-                                    VkDeviceMemory* imageMemory) {
+VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format,
+                                    VkImageTiling tiling, VkImageUsageFlags usageFlags,
+                                    VkMemoryPropertyFlags propertyFlags, VkDeviceMemory* imageMemory,
+                                    MemoryCategory category) {
     // CREATE IMAGE
     // Image create info
     VkImageCreateInfo imageCreateInfo{};
@@ -1791,7 +2527,7 @@ VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat fo
     imageCreateInfo.extent.width = width; // Width of Image extent
     imageCreateInfo.extent.height = height; // Height of Image extent
     imageCreateInfo.extent.depth = 1; // Depth of image (just 1, no 3D aspect)
-    imageCreateInfo.mipLevels = 1; // Number of mipmap levels
+    imageCreateInfo.mipLevels = mipLevels; // Number of mipmap levels
     imageCreateInfo.arrayLayers = 1; // Number of levels in image array
     imageCreateInfo.format = format; // Format type of image
     imageCreateInfo.tiling = tiling; // How image data should be "tiled" (arranged for optimal reading)
@@ -1819,104 +2555,343 @@ VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat fo
     memoryAllocateInfo.memoryTypeIndex = findMemoryTypeIndex(device_.physicalDevice, memoryRequirements.memoryTypeBits,
                                                              propertyFlags);
 
+    // Lazily allocated memory only exists on tile based GPUs, elsewhere transient attachments get normal memory
+    if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX && (propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+        memoryAllocateInfo.memoryTypeIndex = findMemoryTypeIndex(device_.physicalDevice, memoryRequirements.memoryTypeBits,
+                                                                 propertyFlags & ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+    }
+
     result = vkAllocateMemory(device_.logicalDevice, &memoryAllocateInfo, nullptr, imageMemory);
 
     if (result != VK_SUCCESS) throw std::runtime_error("Failed to allocate memory for image");
 
+    MemoryTracker::get().recordAllocation(*imageMemory, memoryAllocateInfo.allocationSize,
+                                          memoryAllocateInfo.memoryTypeIndex, category);
+
     // Connect memory to image
     vkBindImageMemory(device_.logicalDevice, image, *imageMemory, 0);
 
     return image;
 }
 
-int VulkanRenderer::createTextureImage(const std::string &fileName) {
-    // Load image file
-    int width, height;
-    VkDeviceSize imageSize;
-    stbi_uc* imageData = loadTextureFile(fileName, &width, &height, &imageSize);
+int VulkanRenderer::createTexture(const std::string &fileName, std::string* resourceKey) {
+    std::vector<std::string> resourceKeys;
+    int descriptorLoc = createTextures({ fileName }, &resourceKeys)[0];
 
-    // Create staging buffer to hold loaded data, ready to copy to device
-    VkBuffer imageStagingBuffer;
-    VkDeviceMemory imageStagingBufferMemory;
+    if (resourceKey) *resourceKey = resourceKeys[0];
 
-    createBuffer(device_.physicalDevice, device_.logicalDevice, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 &imageStagingBuffer, &imageStagingBufferMemory);
+    return descriptorLoc;
+}
 
-    // Copy image data to staging buffer
-    void* data;
-    vkMapMemory(device_.logicalDevice, imageStagingBufferMemory, 0, imageSize, 0, &data);
-    std::memcpy(data, imageData, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device_.logicalDevice, imageStagingBufferMemory);
+std::vector<int> VulkanRenderer::createTextures(const std::vector<std::string> &fileNames,
+                                                std::vector<std::string>* resourceKeys) {
+    std::vector<int> descriptorLocs(fileNames.size());
 
-    // Free original image data
-    stbi_image_free(imageData);
+    // Textures that aren't loaded yet, with the files of the batch that use each one
+    std::vector<TextureUpload> uploads;
+    std::vector<std::vector<size_t>> uploadUsers;
+    std::unordered_map<std::string, size_t> pendingUploads;
+    std::vector<std::future<void>> decodes;
+
+    // References taken by this batch, and the texture slot between its upload and its registration, undone on failure
+    std::vector<std::string> acquiredKeys;
+    size_t resourceKeyCount = resourceKeys ? resourceKeys->size() : 0;
+    int unregisteredImage = -1;
 
-    // Create image to hold final texture
-    VkImage texImage;
-    VkDeviceMemory texImageMemory;
+    // Workers keep pointers into uploads, so it must never reallocate
+    uploads.reserve(fileNames.size());
 
-    texImage = createImage(width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
-                           VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texImageMemory);
+    try {
+        // Reading, identifying and staging stay on this thread, they need the registry and the device
+        for (size_t i = 0; i < fileNames.size(); ++i) {
+            // Use a pre-compressed version of the texture if there is one the device can sample
+            std::string textureFile = findTextureFile(fileNames[i]);
+
+            // Read the file once, it is used both to identify the texture and to decode it
+            std::vector<char> fileData = readFile("../assets/images/" + textureFile);
+            std::string key = ResourceRegistry::makeKey(textureFile, fileData);
+
+            if (resourceKeys) resourceKeys->push_back(key);
+
+            // Texture already loaded by another material or model, so share its descriptor set
+            if (TextureResource* texture = resourceRegistry.acquireTexture(key)) {
+                acquiredKeys.push_back(key);
+                descriptorLocs[i] = texture->descriptorSet;
+                continue;
+            }
 
-    // COPY DATA TO IMAGE
-    // Transition image to be DST for copy operation
-    transitionImageLayout(device_.logicalDevice, graphicsQueues_, graphicsCommandPool, texImage,
-                          VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            // Same texture used twice in this batch, upload it once
+            auto pending = pendingUploads.find(key);
 
-    // Copy image data
-    copyImageBuffer(device_.logicalDevice, graphicsQueues_, graphicsCommandPool, imageStagingBuffer, texImage,
-                    width, height);
+            if (pending != pendingUploads.end()) {
+                uploadUsers[pending->second].push_back(i);
+                continue;
+            }
 
-    // Transition image to be shader readable for shader usage
-    transitionImageLayout(device_.logicalDevice, graphicsQueues_, graphicsCommandPool,
-                          texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            TextureSource source = parseTextureSource(textureFile, std::move(fileData));
+            source.resourceKey = key;
 
-    // Add texture data to vector for reference
-    textureImages.push_back(texImage);
-    textureImageMemory.push_back(texImageMemory);
+            // Only the coarse levels are loaded now, the finer ones are streamed in when the texture is seen up close
+            uint32_t baseMip = TextureStreamer::getBaseMip(source.width, source.height, source.mipLevels,
+                                                           TEXTURE_STREAMING_BASE_SIZE);
 
-    // Destroy staging buffers
-    vkDestroyBuffer(device_.logicalDevice, imageStagingBuffer, nullptr);
-    vkFreeMemory(device_.logicalDevice, imageStagingBufferMemory, nullptr);
+            pendingUploads.emplace(key, uploads.size());
+            uploadUsers.push_back({ i });
+            uploads.push_back(stageTextureUpload(source, baseMip));
+        }
 
-    // Return index of new texture image
-    return static_cast<int>(textureImages.size()) - 1;
-}
+        // Decode everything on the workers straight into the staging buffers
+        for (auto& upload : uploads) {
+            decodes.push_back(threadPool.submit([&upload] { decodeTexture(upload); }));
+        }
 
-int VulkanRenderer::createTexture(const std::string &fileName) {
-    // Create Texture Image and get its location in array
-    int textureImageLoc = createTextureImage(fileName);
+        // Submit each upload as soon as its decode is done, the GPU copies it while the rest are still decoding
+        for (size_t i = 0; i < uploads.size(); ++i) {
+            decodes[i].get();
 
-    VkImageView imageView = createImageView(textureImages[textureImageLoc], VK_FORMAT_R8G8B8A8_UNORM,
-                                            VK_IMAGE_ASPECT_COLOR_BIT);
+            const TextureSource& source = uploads[i].source;
+            VkDeviceMemory texImageMemory;
+            VkImage texImage = submitTextureUpload(uploads[i], &texImageMemory);
 
-    // Create Image View and add to list
-    textureImageViews.push_back(imageView);
+            // Add texture data to the lists for reference (reusing the slot of a destroyed texture when there is one)
+            int textureImageLoc = allocateTextureImage();
+            textureImages[textureImageLoc] = texImage;
+            textureImageMemory[textureImageLoc] = texImageMemory;
+            textureMipLevels[textureImageLoc] = source.mipLevels - uploads[i].baseMip;
+            textureFormats[textureImageLoc] = source.format;
+            unregisteredImage = textureImageLoc;
 
-    // Create Texture Descriptor Set
-    int descriptorLoc = createTextureDescriptor(imageView);
+            // Create Image View and add to list
+            VkImageView imageView = createImageView(texImage, source.format, VK_IMAGE_ASPECT_COLOR_BIT,
+                                                    textureMipLevels[textureImageLoc]);
+            textureImageViews[textureImageLoc] = imageView;
 
-    // Return location of set witrh texture
-    return descriptorLoc;
+            // Create Texture Descriptor Set, it is only used after the uploads below have finished
+            int descriptorLoc = createTextureDescriptor(imageView);
+
+            resourceRegistry.addTexture(source.resourceKey, textureImageLoc, descriptorLoc);
+            unregisteredImage = -1;
+
+            for (size_t j = 0; j < uploadUsers[i].size(); ++j) {
+                // addTexture holds the first reference, every other user takes its own
+                if (j > 0) resourceRegistry.acquireTexture(source.resourceKey);
+
+                acquiredKeys.push_back(source.resourceKey);
+
+                descriptorLocs[uploadUsers[i][j]] = descriptorLoc;
+            }
+
+            // Hand the texture over to streaming, the source stays around to rebuild finer levels from
+            StreamedTexture streamed{};
+            streamed.textureImage = textureImageLoc;
+            streamed.width = source.width;
+            streamed.height = source.height;
+            streamed.baseMip = uploads[i].baseMip;
+            streamed.residentMip = uploads[i].baseMip;
+
+            for (uint32_t level = 0; level < source.mipLevels; ++level) {
+                streamed.levelSizes.push_back(source.compressed
+                                              ? source.compressed->getLevel(level).size
+                                              : static_cast<VkDeviceSize>(std::max(source.width >> level, 1u)) *
+                                                std::max(source.height >> level, 1u) * STBI_rgb_alpha);
+            }
+
+            textureStreamer.addTexture(descriptorLoc, streamed);
+            textureSources.emplace(descriptorLoc, source);
+        }
+    } catch (...) {
+        // Workers may still be writing into the staging memory, wait for them before it is freed
+        for (auto& decode : decodes) {
+            if (decode.valid()) decode.wait();
+        }
+
+        releaseTextureUploads(uploads);
+
+        // Failed between its upload and its registration, nothing references it but its copy may still be running
+        if (unregisteredImage >= 0) {
+            deletionQueue.push(graphicsTimeline.getSubmittedValue(), [this, loc = unregisteredImage] {
+                if (textureImageViews[loc]) vkDestroyImageView(device_.logicalDevice, textureImageViews[loc], nullptr);
+
+                vkDestroyImage(device_.logicalDevice, textureImages[loc], nullptr);
+                freeMemory(device_.logicalDevice, textureImageMemory[loc]);
+
+                textureImageViews[loc] = VK_NULL_HANDLE;
+                textureImages[loc] = VK_NULL_HANDLE;
+                textureImageMemory[loc] = VK_NULL_HANDLE;
+
+                freeTextureImages.push_back(loc);
+            });
+        }
+
+        // The batch fails as a whole: give back its references, textures it was the only user of are destroyed
+        for (const auto& key : acquiredKeys) {
+            TextureResource released{};
+
+            if (resourceRegistry.releaseTexture(key, &released)) destroyTexture(released);
+        }
+
+        if (resourceKeys) resourceKeys->resize(resourceKeyCount);
+
+        throw;
+    }
+
+    releaseTextureUploads(uploads);
+
+    return descriptorLocs;
 }
 
 int VulkanRenderer::createTextureDescriptor(VkImageView textureImage) {
-    VkDescriptorSet descriptorSet{};
+    int descriptorSlot = allocateTextureDescriptor(textureImage);
+
+    // Id of a destroyed texture, or a new one
+    if (!freeTextureIds.empty()) {
+        int descriptorLoc = freeTextureIds.back();
+        freeTextureIds.pop_back();
+        textureDescriptorSlots[descriptorLoc] = descriptorSlot;
+
+        return descriptorLoc;
+    }
+
+    textureDescriptorSlots.push_back(descriptorSlot);
+
+    return static_cast<int>(textureDescriptorSlots.size()) - 1;
+}
+
+int VulkanRenderer::allocateTextureDescriptor(VkImageView textureImage) {
+    // Descriptor freed once no frame used it anymore so it can simply be rewritten
+    // (the bindless set itself is still bound by pending frames, update after bind allows writing the slots they don't read)
+    if (!freeTextureDescriptors.empty()) {
+        int descriptorSlot = freeTextureDescriptors.back();
+        freeTextureDescriptors.pop_back();
+        updateTextureDescriptor(descriptorSlot, textureImage);
+
+        return descriptorSlot;
+    }
+
+    if (bindlessTextures) {
+        // Next free slot of the bindless array
+        if (bindlessTextureCount >= maxBindlessTextures) throw std::runtime_error("Bindless texture array is full");
+
+        int descriptorSlot = static_cast<int>(bindlessTextureCount++);
+        updateTextureDescriptor(descriptorSlot, textureImage);
+
+        return descriptorSlot;
+    }
 
-    // Descriptor Set Allocation Info
-    VkDescriptorSetAllocateInfo setAllocateInfo{};
-    setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    setAllocateInfo.descriptorPool = samplerDescriptorPool;
-    setAllocateInfo.descriptorSetCount = 1;
-    setAllocateInfo.pSetLayouts = &samplerSetLayout;
+    // Allocate Descriptor Set and add it to list (a new pool is chained when the current one is full)
+    samplerDescriptorSets.push_back(descriptorAllocator.allocate(samplerSetLayout));
 
-    // Allocate Descriptor Set
-    VkResult result = vkAllocateDescriptorSets(device_.logicalDevice, &setAllocateInfo, &descriptorSet);
+    int descriptorSlot = static_cast<int>(samplerDescriptorSets.size()) - 1;
 
-    if (result != VK_SUCCESS) throw std::runtime_error("Failed to allocate Texture Descriptor Sets");
+    updateTextureDescriptor(descriptorSlot, textureImage);
 
+    return descriptorSlot;
+}
+
+VkDescriptorSet VulkanRenderer::allocateFrameDescriptorSet(VkDescriptorSetLayout layout) {
+    // Only valid until this frame slot comes around again, nothing needs to be freed
+    return frames[currentFrame].descriptorAllocator.allocate(layout);
+}
+
+VkDescriptorSet VulkanRenderer::writeInputDescriptorSet() {
+    // Written every frame with the attachments of the frame, so swap chain recreation has no sets to rebuild or retire
+    VkDescriptorSet inputDescriptorSet = allocateFrameDescriptorSet(inputSetLayout);
+
+    // Colour Attachment Descriptor
+    VkDescriptorImageInfo colourAttachmentDescriptor = {};
+    colourAttachmentDescriptor.imageLayout = renderGraph.getReadLayout(colourAttachment);
+    colourAttachmentDescriptor.imageView = renderGraph.getImageView(attachmentImages, colourAttachment, currentFrame);
+    colourAttachmentDescriptor.sampler = VK_NULL_HANDLE;
+
+    // Colour Attachment Descriptor Write
+    VkWriteDescriptorSet colourWrite = {};
+    colourWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    colourWrite.dstSet = inputDescriptorSet;
+    colourWrite.dstBinding = 0;
+    colourWrite.dstArrayElement = 0;
+    colourWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    colourWrite.descriptorCount = 1;
+    colourWrite.pImageInfo = &colourAttachmentDescriptor;
+
+    // Depth Attachment Descriptor
+    VkDescriptorImageInfo depthAttachmentDescriptor = {};
+    depthAttachmentDescriptor.imageLayout = renderGraph.getReadLayout(depthAttachment);
+    depthAttachmentDescriptor.imageView = renderGraph.getImageView(attachmentImages, depthAttachment, currentFrame);
+    depthAttachmentDescriptor.sampler = VK_NULL_HANDLE;
+
+    // Depth Attachment Descriptor Write
+    VkWriteDescriptorSet depthWrite = {};
+    depthWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    depthWrite.dstSet = inputDescriptorSet;
+    depthWrite.dstBinding = 1;
+    depthWrite.dstArrayElement = 0;
+    depthWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    depthWrite.descriptorCount = 1;
+    depthWrite.pImageInfo = &depthAttachmentDescriptor;
+
+    // List of input descriptor set writes
+    std::array<VkWriteDescriptorSet, 2> setWrites = { colourWrite, depthWrite };
+
+    // Update descriptor set
+    vkUpdateDescriptorSets(device_.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+
+    return inputDescriptorSet;
+}
+
+int VulkanRenderer::allocateTextureImage() {
+    if (!freeTextureImages.empty()) {
+        int textureImageLoc = freeTextureImages.back();
+        freeTextureImages.pop_back();
+
+        return textureImageLoc;
+    }
+
+    textureImages.emplace_back();
+    textureImageMemory.emplace_back();
+    textureImageViews.emplace_back();
+    textureMipLevels.emplace_back();
+    textureFormats.emplace_back();
+
+    return static_cast<int>(textureImages.size()) - 1;
+}
+
+void VulkanRenderer::destroyTexture(const TextureResource& texture) {
+    // A residency change in flight is dropped, its upload is a short transfer so just let it finish
+    for (auto stream = textureStreams.begin(); stream != textureStreams.end(); ++stream) {
+        if (stream->descriptorLoc != texture.descriptorSet) continue;
+
+        if (stream->decode.valid()) stream->decode.wait();
+        if (stream->upload.timelineValue) graphicsTimeline.wait(stream->upload.timelineValue);
+        if (stream->image) vkDestroyImage(device_.logicalDevice, stream->image, nullptr);
+        if (stream->imageMemory) freeMemory(device_.logicalDevice, stream->imageMemory);
+
+        releaseTextureUpload(stream->upload);
+        textureStreams.erase(stream);
+        break;
+    }
+
+    textureStreamer.removeTexture(texture.descriptorSet);
+    textureSources.erase(texture.descriptorSet);
+
+    // Frames in flight may still sample it, the image and its slots are freed once they have finished
+    deletionQueue.push(graphicsTimeline.getSubmittedValue(), [this, texture] {
+        int loc = texture.textureImage;
+
+        vkDestroyImageView(device_.logicalDevice, textureImageViews[loc], nullptr);
+        vkDestroyImage(device_.logicalDevice, textureImages[loc], nullptr);
+        freeMemory(device_.logicalDevice, textureImageMemory[loc]);
+
+        textureImageViews[loc] = VK_NULL_HANDLE;
+        textureImages[loc] = VK_NULL_HANDLE;
+        textureImageMemory[loc] = VK_NULL_HANDLE;
+
+        freeTextureImages.push_back(loc);
+        freeTextureDescriptors.push_back(textureDescriptorSlots[texture.descriptorSet]);
+        freeTextureIds.push_back(texture.descriptorSet);
+    });
+}
+
+void VulkanRenderer::updateTextureDescriptor(int descriptorSlot, VkImageView textureImage) {
     // Texture Imaghe Info
     VkDescriptorImageInfo imageInfo{};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; // Image Layout when in use
@@ -1926,24 +2901,542 @@ int VulkanRenderer::createTextureDescriptor(VkImageView textureImage) {
     // Descriptor Write Info
     VkWriteDescriptorSet writeDescriptorSet{};
     writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writeDescriptorSet.dstSet = descriptorSet;
+    writeDescriptorSet.dstSet = bindlessTextures ? bindlessDescriptorSet : samplerDescriptorSets[descriptorSlot];
     writeDescriptorSet.dstBinding = 0;
-    writeDescriptorSet.dstArrayElement = 0;
+    writeDescriptorSet.dstArrayElement = bindlessTextures ? descriptorSlot : 0;
     writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     writeDescriptorSet.descriptorCount = 1;
     writeDescriptorSet.pImageInfo = &imageInfo;
 
-    // Update new descriptor set
+    // Update descriptor set: a per texture set must not be in use by a frame in flight, the bindless array's slot must not
+    // be read by one (the set is update after bind)
     vkUpdateDescriptorSets(device_.logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
+}
+
+TextureSource VulkanRenderer::parseTextureSource(const std::string &fileName, std::vector<char> fileData) {
+    TextureSource source{};
+    source.fileName = fileName;
+
+    if (Ktx2Texture::isKtx2(fileData)) {
+        // Mip levels are pre-built in the file, so they are uploaded as they are (no decode, no blit)
+        auto compressed = std::make_shared<Ktx2Texture>(Ktx2Texture::load(fileName, std::move(fileData)));
+
+        source.format = compressed->getFormat();
+        source.width = compressed->getWidth();
+        source.height = compressed->getHeight();
+        source.mipLevels = compressed->getLevelCount();
+        source.compressed = std::move(compressed);
+    } else {
+        // Only the header is parsed here, the pixels are decoded on a worker
+        int width, height, channels;
+
+        if (!stbi_info_from_memory(reinterpret_cast<const stbi_uc*>(fileData.data()), static_cast<int>(fileData.size()),
+                                   &width, &height, &channels)) {
+            throw std::runtime_error("Failed to load a Texture file: " + fileName);
+        }
 
-    // Add descriptor set to list
-    samplerDescriptorSets.push_back(descriptorSet);
+        source.fileData = std::make_shared<const std::vector<char>>(std::move(fileData));
+        source.format = VK_FORMAT_R8G8B8A8_UNORM;
+        source.width = width;
+        source.height = height;
 
-    // Return descriptor set location
-    return static_cast<int>(samplerDescriptorSets.size()) - 1;
+        // Full mip chain down to 1x1
+        source.mipLevels = getMipLevels(width, height);
+
+        // If the GPU can't linear filter blit this format, build the mip chain on the CPU and upload every level
+        source.blitMipmaps = checkLinearBlitSupport(source.format);
+    }
+
+    return source;
+}
+
+TextureUpload VulkanRenderer::stageTextureUpload(const TextureSource &source, uint32_t baseMip) {
+    TextureUpload upload{};
+    upload.source = source;
+    upload.baseMip = baseMip;
+
+    uint32_t levelCount = source.blitMipmaps ? 1 : source.mipLevels - baseMip;
+
+    for (uint32_t i = 0; i < levelCount; ++i) {
+        uint32_t mipLevel = baseMip + i;
+
+        // Keep each level aligned to the largest texel block size (16 bytes)
+        upload.stagingSize = (upload.stagingSize + 15) & ~static_cast<VkDeviceSize>(15);
+
+        // Image levels are numbered from the base of the upload
+        VkBufferImageCopy imageRegion{};
+        imageRegion.bufferOffset = upload.stagingSize;
+        imageRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        imageRegion.imageSubresource.mipLevel = i;
+        imageRegion.imageSubresource.layerCount = 1;
+        imageRegion.imageExtent = { std::max(source.width >> mipLevel, 1u), std::max(source.height >> mipLevel, 1u), 1 };
+
+        upload.imageRegions.push_back(imageRegion);
+        upload.stagingSize += source.compressed
+                              ? source.compressed->getLevel(mipLevel).size
+                              : static_cast<VkDeviceSize>(imageRegion.imageExtent.width) *
+                                imageRegion.imageExtent.height * STBI_rgb_alpha;
+    }
+
+    // Create staging buffer to hold every level, ready to copy to device
+    createBuffer(device_.physicalDevice, device_.logicalDevice, upload.stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &upload.stagingBuffer, &upload.stagingBufferMemory, MemoryCategory::STAGING);
+
+    // Stays mapped until the upload is released, the worker writes the texture straight into it
+    vkMapMemory(device_.logicalDevice, upload.stagingBufferMemory, 0, upload.stagingSize, 0, &upload.stagingData);
+
+    return upload;
 }
 
-int VulkanRenderer::createMeshModel(const std::string &modelFile) {
+void VulkanRenderer::decodeTexture(TextureUpload &upload) {
+    // Runs on a worker thread: only touches the upload, never the device or the renderer
+    const TextureSource& source = upload.source;
+    auto* data = static_cast<char*>(upload.stagingData);
+
+    if (source.compressed) {
+        for (size_t i = 0; i < upload.imageRegions.size(); ++i) {
+            const Ktx2Level& level = source.compressed->getLevel(upload.baseMip + i);
+            std::memcpy(data + upload.imageRegions[i].bufferOffset, source.compressed->getData() + level.offset,
+                        level.size);
+        }
+
+        return;
+    }
+
+    // Decode pixel data for image from the already read file
+    int width, height, channels;
+    stbi_uc* imageData = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(source.fileData->data()),
+                                               static_cast<int>(source.fileData->size()), &width, &height, &channels,
+                                               STBI_rgb_alpha);
+
+    if (!imageData) throw std::runtime_error("Failed to load a Texture file: " + source.fileName);
+
+    if (static_cast<uint32_t>(width) != source.width || static_cast<uint32_t>(height) != source.height) {
+        stbi_image_free(imageData);
+        throw std::runtime_error("Texture file size doesn't match its header: " + source.fileName);
+    }
+
+    // Filter in cached memory down to the base of the upload, reading back from the mapped staging memory would be slow
+    std::vector<stbi_uc> pixels(imageData, imageData + static_cast<size_t>(width) * height * STBI_rgb_alpha);
+    stbi_image_free(imageData);
+
+    std::vector<stbi_uc> mipChain(upload.stagingSize);
+    uint32_t mipWidth = source.width;
+    uint32_t mipHeight = source.height;
+
+    for (uint32_t i = 0; i < upload.baseMip; ++i) {
+        std::vector<stbi_uc> nextPixels(std::max(mipWidth / 2, 1u) * std::max(mipHeight / 2, 1u) * STBI_rgb_alpha);
+        downsampleImage(pixels.data(), mipWidth, mipHeight, nextPixels.data());
+
+        pixels = std::move(nextPixels);
+        mipWidth = std::max(mipWidth / 2, 1u);
+        mipHeight = std::max(mipHeight / 2, 1u);
+    }
+
+    std::memcpy(mipChain.data(), pixels.data(), pixels.size());
+
+    // Without blits the rest of the chain is built here as well
+    for (size_t i = 1; i < upload.imageRegions.size(); ++i) {
+        const VkExtent3D& srcExtent = upload.imageRegions[i - 1].imageExtent;
+        downsampleImage(mipChain.data() + upload.imageRegions[i - 1].bufferOffset, srcExtent.width,
+                        srcExtent.height, mipChain.data() + upload.imageRegions[i].bufferOffset);
+    }
+
+    std::memcpy(data, mipChain.data(), static_cast<size_t>(upload.stagingSize));
+}
+
+VkImage VulkanRenderer::submitTextureUpload(TextureUpload &upload, VkDeviceMemory* imageMemory) {
+    const TextureSource& source = upload.source;
+    uint32_t width = std::max(source.width >> upload.baseMip, 1u);
+    uint32_t height = std::max(source.height >> upload.baseMip, 1u);
+    uint32_t mipLevels = source.mipLevels - upload.baseMip;
+
+    // Create image to hold final texture, transfer source for blits and for evicting levels later
+    VkImage texImage = createImage(width, height, mipLevels, source.format, VK_IMAGE_TILING_OPTIMAL,
+                                   VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                   VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, imageMemory,
+                                   MemoryCategory::TEXTURE);
+
+    // Record the whole upload in one command buffer: transition, copy, mip chain / final transition
+    upload.commandBuffer = beginCmdBuffer(device_.logicalDevice, graphicsCommandPool);
+
+    recordImageLayoutTransition(upload.commandBuffer, texImage, VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+
+    vkCmdCopyBufferToImage(upload.commandBuffer, upload.stagingBuffer, texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(upload.imageRegions.size()), upload.imageRegions.data());
+
+    if (source.blitMipmaps) {
+        // Generate the rest of the chain from level 0, also leaves the image shader readable
+        recordMipmaps(upload.commandBuffer, texImage, width, height, mipLevels);
+    } else {
+        // Transition image to be shader readable for shader usage
+        recordImageLayoutTransition(upload.commandBuffer, texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
+    }
+
+    upload.timelineValue = submitTransferCommands(upload.commandBuffer);
+
+    return texImage;
+}
+
+uint64_t VulkanRenderer::submitTransferCommands(VkCommandBuffer cmdBuffer) {
+    vkEndCommandBuffer(cmdBuffer);
+
+    // Timeline value instead of waiting for the queue to be idle, so the next upload isn't held up
+    return graphicsTimeline.submit({ cmdBuffer });
+}
+
+void VulkanRenderer::releaseTextureUpload(TextureUpload &upload) {
+    // Commands must have finished (or never been submitted)
+    if (upload.commandBuffer) vkFreeCommandBuffers(device_.logicalDevice, graphicsCommandPool, 1, &upload.commandBuffer);
+    if (upload.stagingData) vkUnmapMemory(device_.logicalDevice, upload.stagingBufferMemory);
+
+    vkDestroyBuffer(device_.logicalDevice, upload.stagingBuffer, nullptr);
+    freeMemory(device_.logicalDevice, upload.stagingBufferMemory);
+
+    upload = TextureUpload{};
+}
+
+void VulkanRenderer::releaseTextureUploads(std::vector<TextureUpload> &uploads) {
+    uint64_t lastUpload = 0;
+
+    for (const auto& upload : uploads) {
+        lastUpload = std::max(lastUpload, upload.timelineValue);
+    }
+
+    // Staging buffers can only go once every copy out of them has finished (values complete in order)
+    graphicsTimeline.wait(lastUpload);
+
+    for (auto& upload : uploads) {
+        releaseTextureUpload(upload);
+    }
+
+    uploads.clear();
+}
+
+void VulkanRenderer::updateTextureStreaming() {
+    // Raises still decoding or copying, they limit how many new ones start this frame
+    uint32_t raisesInFlight = 0;
+    std::vector<std::list<TextureStream>::iterator> finished;
+
+    for (auto stream = textureStreams.begin(); stream != textureStreams.end();) {
+        bool isRaise = stream->decode.valid() || stream->upload.stagingBuffer;
+
+        // Decode finished on its worker, the upload can go to the GPU
+        if (!stream->upload.timelineValue) {
+            if (stream->decode.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++raisesInFlight;
+                ++stream;
+                continue;
+            }
+
+            try {
+                stream->decode.get();
+                stream->image = submitTextureUpload(stream->upload, &stream->imageMemory);
+            } catch (const std::exception& error) {
+                // Keep the resident levels, the texture just stays blurrier
+                spdlog::warn("[Vulkan-Renderer] Texture streaming failed: {}", error.what());
+
+                if (stream->image) vkDestroyImage(device_.logicalDevice, stream->image, nullptr);
+                if (stream->imageMemory) freeMemory(device_.logicalDevice, stream->imageMemory);
+
+                textureStreamer.cancel(stream->descriptorLoc);
+                releaseTextureUpload(stream->upload);
+                stream = textureStreams.erase(stream);
+                continue;
+            }
+        }
+
+        if (graphicsTimeline.isComplete(stream->upload.timelineValue)) {
+            finished.push_back(stream);
+        } else if (isRaise) {
+            ++raisesInFlight;
+        }
+
+        ++stream;
+    }
+
+    for (auto stream : finished) {
+        int textureImageLoc = textureStreamer.getTexture(stream->descriptorLoc)->textureImage;
+        uint32_t mipLevels = textureSources.at(stream->descriptorLoc).mipLevels - stream->targetMip;
+        VkImageView imageView{};
+        int descriptorSlot;
+
+        try {
+            imageView = createImageView(stream->image, textureFormats[textureImageLoc], VK_IMAGE_ASPECT_COLOR_BIT,
+                                        mipLevels);
+            descriptorSlot = allocateTextureDescriptor(imageView);
+        } catch (const std::exception& error) {
+            // No descriptor for it (bindless array full), keep the resident levels
+            spdlog::warn("[Vulkan-Renderer] Texture streaming failed: {}", error.what());
+
+            if (imageView) vkDestroyImageView(device_.logicalDevice, imageView, nullptr);
+            vkDestroyImage(device_.logicalDevice, stream->image, nullptr);
+            freeMemory(device_.logicalDevice, stream->imageMemory);
+
+            textureStreamer.cancel(stream->descriptorLoc);
+            releaseTextureUpload(stream->upload);
+            textureStreams.erase(stream);
+            continue;
+        }
+
+        // Frames in flight still sample the old image through the old descriptor, both go once they have finished
+        VkImageView oldView = textureImageViews[textureImageLoc];
+        VkImage oldImage = textureImages[textureImageLoc];
+        VkDeviceMemory oldMemory = textureImageMemory[textureImageLoc];
+        int oldSlot = textureDescriptorSlots[stream->descriptorLoc];
+
+        deletionQueue.push(graphicsTimeline.getSubmittedValue(), [this, oldView, oldImage, oldMemory, oldSlot] {
+            vkDestroyImageView(device_.logicalDevice, oldView, nullptr);
+            vkDestroyImage(device_.logicalDevice, oldImage, nullptr);
+            freeMemory(device_.logicalDevice, oldMemory);
+
+            freeTextureDescriptors.push_back(oldSlot);
+        });
+
+        // Swap the new image in, the next frames sample it through a descriptor no pending frame reads
+        textureImages[textureImageLoc] = stream->image;
+        textureImageMemory[textureImageLoc] = stream->imageMemory;
+        textureImageViews[textureImageLoc] = imageView;
+        textureMipLevels[textureImageLoc] = mipLevels;
+        textureDescriptorSlots[stream->descriptorLoc] = descriptorSlot;
+        textureStreamer.setResident(stream->descriptorLoc, stream->targetMip);
+
+        releaseTextureUpload(stream->upload);
+        textureStreams.erase(stream);
+    }
+
+    gatherTextureDemand();
+
+    for (const auto& request : textureStreamer.update(MAX_TEXTURE_STREAMS - std::min(raisesInFlight, MAX_TEXTURE_STREAMS))) {
+        startTextureStream(request);
+    }
+}
+
+void VulkanRenderer::gatherTextureDemand() {
+    textureStreamer.beginFrame();
+
+    // Height in pixels of something 1 unit tall, 1 unit in front of the camera
+    float pixelsPerUnit = std::abs(uboViewProjection.projection[1][1]) * 0.5f * static_cast<float>(swapChainExtent_.height);
+
+    for (auto& model : modelList) {
+        const glm::mat4& modelMatrix = model.getModel();
+        glm::mat4 modelView = uboViewProjection.view * modelMatrix;
+
+        // Largest axis scale keeps the bounding sphere conservative
+        float scale = std::max({ glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])),
+                                 glm::length(glm::vec3(modelMatrix[2])) });
+
+        for (size_t i = 0; i < model.getMeshCount(); ++i) {
+            Mesh* mesh = model.getMesh(i);
+            StreamedTexture* texture = textureStreamer.getTexture(mesh->getTextureId());
+
+            if (!texture) continue;
+
+            const glm::vec4& sphere = mesh->getBoundingSphere();
+            float radius = sphere.w * scale;
+            float depth = -(modelView * glm::vec4(glm::vec3(sphere), 1.0f)).z;
+
+            // Entirely behind the camera, nothing to ask for
+            if (depth + radius <= 0.0f) continue;
+
+            // Size on screen of the nearest point of the sphere, the camera being inside it wants full detail
+            float projectedSize = 2.0f * radius * pixelsPerUnit / std::max(depth - radius, 0.01f);
+
+            // The texture is assumed to cover the mesh once, so the level matching the projected size is enough
+            float texels = static_cast<float>(std::max(texture->width, texture->height));
+            float mip = std::floor(std::log2(std::max(texels / std::max(projectedSize, 1.0f), 1.0f)));
+
+            textureStreamer.requestMip(mesh->getTextureId(), static_cast<uint32_t>(mip));
+        }
+    }
+}
+
+void VulkanRenderer::startTextureStream(const StreamRequest &request) {
+    StreamedTexture* texture = textureStreamer.getTexture(request.descriptorSet);
+
+    TextureStream& stream = textureStreams.emplace_back();
+    stream.descriptorLoc = request.descriptorSet;
+    stream.targetMip = request.targetMip;
+
+    try {
+        if (request.targetMip < texture->residentMip) {
+            // Raise: decode the finer levels on a worker, updateTextureStreaming submits them once ready
+            stream.upload = stageTextureUpload(textureSources.at(request.descriptorSet), request.targetMip);
+            stream.decode = threadPool.submit([&stream] { decodeTexture(stream.upload); });
+        } else {
+            // Evict: the kept levels are already on the GPU, copy them into a smaller image
+            recordTextureEviction(stream, texture->textureImage, request.targetMip - texture->residentMip);
+        }
+    } catch (const std::exception& error) {
+        // Out of memory while streaming isn't fatal, the texture keeps what it has
+        spdlog::warn("[Vulkan-Renderer] Texture streaming failed: {}", error.what());
+
+        if (stream.image) vkDestroyImage(device_.logicalDevice, stream.image, nullptr);
+        if (stream.imageMemory) freeMemory(device_.logicalDevice, stream.imageMemory);
+
+        textureStreamer.cancel(request.descriptorSet);
+        releaseTextureUpload(stream.upload);
+        textureStreams.pop_back();
+    }
+}
+
+void VulkanRenderer::recordTextureEviction(TextureStream &stream, int textureImage, uint32_t droppedLevels) {
+    const TextureSource& source = textureSources.at(stream.descriptorLoc);
+    VkImage oldImage = textureImages[textureImage];
+    uint32_t width = std::max(source.width >> stream.targetMip, 1u);
+    uint32_t height = std::max(source.height >> stream.targetMip, 1u);
+    uint32_t mipLevels = source.mipLevels - stream.targetMip;
+
+    stream.image = createImage(width, height, mipLevels, source.format, VK_IMAGE_TILING_OPTIMAL,
+                               VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                               VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &stream.imageMemory,
+                               MemoryCategory::TEXTURE);
+
+    VkCommandBuffer cmdBuffer = beginCmdBuffer(device_.logicalDevice, graphicsCommandPool);
+    stream.upload.commandBuffer = cmdBuffer;
+
+    // Frames keep sampling the old image until the swap, so it goes back to shader readable after the copy
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = oldImage;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = droppedLevels;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+
+    recordImageLayoutTransition(cmdBuffer, stream.image, VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+
+    // Level i of the new image is level i + droppedLevels of the old one
+    std::vector<VkImageCopy> imageCopies(mipLevels);
+
+    for (uint32_t i = 0; i < mipLevels; ++i) {
+        imageCopies[i].srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i + droppedLevels, 0, 1 };
+        imageCopies[i].dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+        imageCopies[i].extent = { std::max(width >> i, 1u), std::max(height >> i, 1u), 1 };
+    }
+
+    vkCmdCopyImage(cmdBuffer, oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stream.image,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels, imageCopies.data());
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+
+    recordImageLayoutTransition(cmdBuffer, stream.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
+
+    stream.upload.timelineValue = submitTransferCommands(cmdBuffer);
+}
+
+bool VulkanRenderer::checkLinearBlitSupport(VkFormat format) {
+    // vkCmdBlitImage with VK_FILTER_LINEAR needs the format to be a blit source/destination and linear filterable
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(device_.physicalDevice, format, &properties);
+
+    VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    return (properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
+
+void VulkanRenderer::recordMipmaps(VkCommandBuffer cmdBuffer, VkImage image, uint32_t width, uint32_t height,
+                                   uint32_t mipLevels) {
+    // Barrier reused for every level, only one level is altered at a time
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    auto mipWidth = static_cast<int32_t>(width);
+    auto mipHeight = static_cast<int32_t>(height);
+
+    for (uint32_t i = 1; i < mipLevels; ++i) {
+        // Previous level has been written, make it the blit source
+        barrier.subresourceRange.baseMipLevel = i - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+
+        int32_t nextWidth = std::max(mipWidth / 2, 1);
+        int32_t nextHeight = std::max(mipHeight / 2, 1);
+
+        // Downsample previous level into this one
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = { 0, 0, 0 };
+        blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = i - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.dstOffsets[0] = { 0, 0, 0 };
+        blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = i;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+
+        vkCmdBlitImage(cmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        // Previous level is finished, make it shader readable
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+
+        mipWidth = nextWidth;
+        mipHeight = nextHeight;
+    }
+
+    // Last level was only ever written to
+    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+ModelHandle VulkanRenderer::createMeshModel(const std::string &modelFile) {
+    // Identify the model by path and content so loading the same file again shares its buffers
+    std::string modelKey = ResourceRegistry::makeKey(modelFile, readFile(modelFile));
+
+    if (GeometryResource* geometry = resourceRegistry.acquireGeometry(modelKey)) {
+        return addMeshModel(MeshModel(geometry->meshList, modelKey));
+    }
+
     // Import model "scene"
     Assimp::Importer importer;
     const aiScene *scene = importer.ReadFile(modelFile, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
@@ -1958,41 +3451,71 @@ int VulkanRenderer::createMeshModel(const std::string &modelFile) {
     // Conversion from the materials list IDs to our Descriptor Array IDs
     std::vector<int> matToTex(textureNames.size());
 
-    // Loop over textureNames and create textures for them
+    // Textures acquired by this model, released together with its geometry
+    std::vector<std::string> textureKeys;
+
+    // Gather every material texture so they are decoded in parallel, as one batch
+    std::vector<std::string> materialTextures;
+    std::vector<size_t> materialIndices;
+
     for (size_t i = 0; i < textureNames.size(); i++) {
         // If material had no texture, set '0' to indicate no texture, texture 0 will be reserved for a default texture
         if (textureNames[i].empty()) {
             matToTex[i] = 0;
         } else {
-            // Otherwise, create texture and set value to index of new texture
-            matToTex[i] = createTexture(textureNames[i]);
+            materialTextures.push_back(textureNames[i]);
+            materialIndices.push_back(i);
         }
     }
 
+    // Create textures (or reuse already loaded ones) and set value to index of the texture
+    std::vector<int> textureLocs = createTextures(materialTextures, &textureKeys);
+
+    for (size_t i = 0; i < materialIndices.size(); i++) {
+        matToTex[materialIndices[i]] = textureLocs[i];
+    }
+
     // Load in all our meshes
-    std::vector<Mesh> modelMeshes = MeshModel::LoadNode(device_.physicalDevice, device_.logicalDevice, graphicsQueues_,
-                                                        graphicsCommandPool,
+    std::vector<Mesh> modelMeshes = MeshModel::LoadNode(geometryHeap, graphicsTimeline, graphicsCommandPool,
                                                         scene->mRootNode, scene, matToTex);
 
-    // Create mesh model and add to list
-    MeshModel meshModel = MeshModel(modelMeshes);
-    modelList.push_back(meshModel);
+    resourceRegistry.addGeometry(modelKey, modelMeshes, textureKeys);
 
-    return modelList.size() - 1;
+    // Create mesh model and add to list
+    return addMeshModel(MeshModel(modelMeshes, modelKey));
 }
 
-stbi_uc* VulkanRenderer::loadTextureFile(const std::string &fileName, int *width, int *height, VkDeviceSize *imageSize) {
-    // Number of channels image usage
-    int channels;
+ModelHandle VulkanRenderer::addMeshModel(MeshModel meshModel) {
+    ModelHandle handle = modelList.insert(std::move(meshModel));
 
-    // Load pixel data for image
-    std::string fileLoc = "../assets/images/" + fileName;
-    stbi_uc* image = stbi_load(fileLoc.c_str(), width, height, &channels, STBI_rgb_alpha);
+    // Its record is at its slot, a reused slot overwrites the record of the destroyed model
+    if (handle.index >= objectData.size()) {
+        objectData.resize(handle.index + 1);
+        objectDirty.resize(handle.index + 1);
+    }
 
-    if (!image) throw std::runtime_error("Failed to load a Texture file: " + fileName);
+    objectData[handle.index].model = modelList.get(handle)->getModel();
+    markObjectDirty(handle.index);
 
-    // Calculate image size using given and known data
-    *imageSize = *width * *height * static_cast<int>(STBI_rgb_alpha);
+    // New draws, the packets are recompiled before the next frame is recorded
+    drawListDirty = true;
 
-    return image;
+    return handle;
+}
+
+std::string VulkanRenderer::findTextureFile(const std::string &fileName) {
+    // Compressed versions live next to the source image: BC (texture-encoder output) first, then the mobile formats
+    std::string stem = fileName.substr(0, fileName.rfind('.'));
+
+    for (const char* suffix : { ".ktx2", ".astc.ktx2", ".etc2.ktx2" }) {
+        std::string candidate = stem + suffix;
+        VkFormat format = Ktx2Texture::readFormat("../assets/images/" + candidate);
+
+        if (format != VK_FORMAT_UNDEFINED && checkTextureFormatSupport(format)) {
+            return candidate;
+        }
+    }
+
+    // Fall back to decoding the source image
+    return fileName;
 }
@@ -2,8 +2,11 @@
 #define VULKAN_COURSE_VULKANRENDERER_HPP
 
 
+#include <future>
+#include <list>
 #include <memory>
 #include <stdexcept>
+#include <unordered_map>
 #include <vector>
 
 #include "vulkan//vulkan.h"
@@ -12,6 +15,22 @@
 
 #include "Window.hpp"
 #include "Mesh.hpp"
+#include "ResourceRegistry.hpp"
+#include "Ktx2Texture.hpp"
+#include "ThreadPool.hpp"
+#include "DescriptorAllocator.hpp"
+#include "PipelineCache.hpp"
+#include "ShaderRegistry.hpp"
+#include "ShaderWatcher.hpp"
+#include "SlotMap.hpp"
+#include "DeletionQueue.hpp"
+#include "GpuTimeline.hpp"
+#include "FrameLimiter.hpp"
+#include "RenderGraph.hpp"
+#include "TextureStreamer.hpp"
+#include "MemoryTracker.hpp"
+#include "GeometryHeap.hpp"
+#include "FrameCapture.hpp"
 
 
 class ValidationLayers;
@@ -28,6 +47,135 @@ struct Device {
     VkDevice logicalDevice{};
 };
 
+// Parsed texture file, kept in memory so streamed levels can be rebuilt from it at any time
+struct TextureSource {
+    std::string fileName;
+    std::string resourceKey;
+    std::shared_ptr<const std::vector<char>> fileData; // Encoded image bytes (PNG, JPG...), decoded per upload
+    std::shared_ptr<const Ktx2Texture> compressed; // Set instead of fileData for KTX2 files
+    bool blitMipmaps{false}; // Only upload the first level and blit the rest of the chain on the GPU
+    VkFormat format{VK_FORMAT_UNDEFINED};
+    uint32_t width{}; // Size of level 0
+    uint32_t height{};
+    uint32_t mipLevels{}; // Full chain
+};
+
+// Levels [baseMip, mipLevels) of a texture on their way to the GPU: staged on the main thread, decoded on a worker,
+// uploaded on the main thread
+struct TextureUpload {
+    TextureSource source;
+    uint32_t baseMip{}; // Level of the source that becomes level 0 of the image
+    std::vector<VkBufferImageCopy> imageRegions;
+    VkDeviceSize stagingSize{};
+    VkBuffer stagingBuffer{};
+    VkDeviceMemory stagingBufferMemory{};
+    void* stagingData{}; // Mapped staging memory the worker writes into
+    VkCommandBuffer commandBuffer{};
+    uint64_t timelineValue{}; // Graphics timeline value of the submitted commands, 0 until submitted
+};
+
+// Residency change of a streamed texture, its image replaces the current one once the commands have finished
+struct TextureStream {
+    int descriptorLoc{};
+    uint32_t targetMip{};
+    TextureUpload upload; // Staging (raises only), command buffer and fence
+    std::future<void> decode; // Raises decode the finer levels, evictions copy the kept ones on the GPU
+    VkImage image{};
+    VkDeviceMemory imageMemory{};
+};
+
+// Vertex buffers a pipeline reads
+enum class VertexLayout {
+    NONE, // Full screen pass, no vertex buffer
+    FULL, // Vertex (position, colour, texture coords)
+    POSITION // Positions only, for the depth pre-pass
+};
+
+// Everything a pipeline is built from besides the shared fixed function state
+struct PipelineDesc {
+    std::string vertexShader; // SPIR-V names in the shader registry
+    std::string fragmentShader; // Empty for depth only pipelines
+    VkPipelineLayout layout{};
+    uint32_t subpass{};
+    VertexLayout vertexLayout{VertexLayout::FULL};
+    bool depthWrite{true};
+    VkCompareOp depthCompare{VK_COMPARE_OP_LESS};
+    std::vector<VkSpecializationMapEntry> specializationEntries; // Fragment shader constants
+    std::vector<char> specializationData;
+};
+
+// What the second pass shows, matches the VIEW_MODE constant of second.frag
+enum class PostProcessMode : int32_t {
+    COLOUR = 0,
+    DEPTH = 1,
+    SPLIT = 2 // Colour on the left half, depth on the right
+};
+
+// Latency / power trade-off of the swap chain, picks the first present mode of its list the surface supports
+enum class PresentPolicy {
+    LOW_LATENCY, // MAILBOX, FIFO_RELAXED, FIFO: newest frame at each refresh without tearing
+    POWER_SAVING, // FIFO: vsync, the GPU idles once the swap chain is full
+    UNCAPPED // IMMEDIATE, MAILBOX, FIFO: as many frames as possible, may tear (benchmarks)
+};
+
+// Specialization constants of second.frag (constant_id 0 to 3, in order)
+struct PostProcessConstants {
+    PostProcessMode mode;
+    uint32_t splitX;
+    float depthLowerBound;
+    float depthUpperBound;
+};
+
+// Pipeline the renderer binds, plus the build that will replace it (compiled on a worker thread)
+struct PipelineSlot {
+    PipelineDesc desc;
+    VkPipeline* pipeline{}; // Renderer member the pipeline is swapped into
+    std::future<VkPipeline> pending;
+    bool rebuildQueued{false}; // Shaders changed again while building
+};
+
+// Swap chain and everything sized to it, destroyed through the deletion queue
+struct RetiredSwapChain {
+    VkSurfaceKHR surface{}; // Only set when the surface was lost, destroyed after its swap chain
+    VkSwapchainKHR swapChain{};
+    std::vector<VkImageView> imageViews;
+    std::vector<VkFramebuffer> framebuffers;
+    RenderGraphImages attachments; // Colour and depth attachments
+};
+
+// Everything one frame in flight records and submits with, reused once its timeline value has completed
+struct FrameContext {
+    VkCommandPool commandPool{}; // Reset as a whole when the frame comes around again
+    VkCommandBuffer commandBuffer{};
+    VkDeviceSize uniformOffset{}; // Slice of the shared ViewProjection buffer
+    VkDeviceSize objectStagingOffset{}; // Slice of the object staging buffer, dirty records are copied from it
+    VkSemaphore imageAvailable{}; // Binary, acquire and present can't use the timeline
+    VkSemaphore renderFinished{};
+    uint64_t timelineValue{}; // Graphics timeline value of the last submission, 0 before the first
+    DescriptorAllocator descriptorAllocator; // Transient sets (input attachments), reset with the frame
+    std::vector<GeometryRange> vacatedGeometry; // Left by the defragmenter's moves, released with the frame
+};
+
+// One mesh draw, compiled from the scene when models are added or removed and walked by the recorder
+// Everything recording needs is copied in, so a frame never goes through the models and meshes themselves
+struct DrawPacket {
+    uint64_t sortKey{}; // Pipeline, texture, buffers: most expensive state change in the highest bits
+    uint32_t modelIndex{}; // Into the model list, for the model matrix
+    uint32_t objectIndex{}; // Record in the object buffer, passed as the first instance of the draw
+    int textureId{};
+    VkBuffer vertexBuffer{}; // Geometry blocks and the offsets of the mesh in them
+    VkDeviceSize vertexOffset{};
+    VkBuffer positionBuffer{};
+    VkDeviceSize positionOffset{};
+    VkBuffer indexBuffer{};
+    VkDeviceSize indexOffset{};
+    uint32_t indexCount{};
+    glm::vec4 boundingSphere{}; // Model space, for the per frame depth order
+};
+
+// Loaded model, becomes invalid (and is ignored) once the model is destroyed
+using ModelHandle = SlotHandle;
+
 class VulkanRenderer {
     public:
         explicit VulkanRenderer(std::unique_ptr<Window>& window);
@@ -35,8 +183,19 @@ class VulkanRenderer {
         int init();
         void clean();
         void draw();
-        void updateModel(int modelID, glm::mat4 newModel);
-        int createMeshModel(const std::string& modelFile);
+        void updateModel(ModelHandle model, glm::mat4 newModel);
+        ModelHandle createMeshModel(const std::string& modelFile);
+        void destroyMeshModel(ModelHandle model);
+        void setTextureBudget(VkDeviceSize budget);
+        void setPostProcessMode(PostProcessMode mode);
+        void setPresentPolicy(PresentPolicy policy);
+        void setFrameLimit(double maxFps);
+        void setFramesInFlight(uint32_t count);
+        void setDepthPrePass(bool enabled);
+        void setMemoryWarningThreshold(float fraction);
+        [[nodiscard]] MemoryStats getMemoryStats() const;
+        void captureFrame(const std::string& path, CaptureFormat format = CaptureFormat::PNG);
+        void setCaptureRecording(const std::string& directory, CaptureFormat format = CaptureFormat::PNG);
 
     private:
         // Vulkan function
@@ -49,22 +208,36 @@ class VulkanRenderer {
         void createRenderPass();
         void createDescriptorSetLayout();
         void createPushConstantRange();
-        void createColourBufferImage();
-        void createDepthBufferImage();
+        void createAttachmentImages();
         void createFramebuffers();
         void createCommandPool();
         void createCommandBuffers();
         void createSynchronisation();
         void createUniformBuffers();
+        void createFrameContexts();
+        void destroyFrameContexts();
         void createDescriptorPool();
         void createDescriptorSets();
         void createTextureSampler();
-        void createInputDescriptorSets();
+        void createObjectBuffers(uint32_t capacity);
+        void destroyObjectBuffers();
+        ModelHandle addMeshModel(MeshModel meshModel);
 
-        void updateUniformBuffers(uint32_t imageIndex);
+        void updateUniformBuffers(const FrameContext& frame);
+        void recordObjectUpload(const FrameContext& frame, VkCommandBuffer commandBuffer);
+        void markObjectDirty(uint32_t objectIndex);
+        void updateProjection();
+
+        // - Swap chain recreation
+        void recreateSwapChain();
+        void destroyRetiredSwapChain(RetiredSwapChain& retired);
 
         // - Record Functions
-        void recordCommands(uint32_t currentImage);
+        void recordCommands(FrameContext& frame, uint32_t currentImage);
+        void recordSceneDraws(VkCommandBuffer commandBuffer, VkPipelineLayout layout, bool positionsOnly, bool depthOrder,
+                              uint32_t vpOffset);
+        void compileDrawPackets();
+        void buildDrawList();
 
         // - Get functions
         void getPhysicalDevice();
@@ -77,6 +250,7 @@ class VulkanRenderer {
         bool checkInstanceSupport(std::vector<const char*>* extensions);
         bool checkDeviceExtensionSupport(VkPhysicalDevice device);
         bool checkDeviceSuitable(VkPhysicalDevice device);
+        bool checkTextureFormatSupport(VkFormat format);
 
         // -- Getter functions
         QueueFamilyIndices getQueueFamilies(VkPhysicalDevice device);
@@ -90,91 +264,196 @@ class VulkanRenderer {
                                        VkFormatFeatureFlags featureFlags);
 
         // -- Create functions
-        VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
-        VkShaderModule createShaderModule(const std::vector<char>& code);
-        VkImage createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
-                            VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags,
-                            VkDeviceMemory* imageMemory);
-        int createTextureImage(const std::string& fileName);
-        int createTexture(const std::string& fileName);
+        VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+                                    uint32_t mipLevels);
+        VkShaderModule createShaderModule(const std::vector<uint32_t>& code);
+        VkImage createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format,
+                            VkImageTiling tiling, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags,
+                            VkDeviceMemory* imageMemory, MemoryCategory category);
+        int createTexture(const std::string& fileName, std::string* resourceKey = nullptr);
+        std::vector<int> createTextures(const std::vector<std::string>& fileNames,
+                                        std::vector<std::string>* resourceKeys = nullptr);
         int createTextureDescriptor(VkImageView textureImage);
+        int allocateTextureDescriptor(VkImageView textureImage);
+        int allocateTextureImage();
+        void destroyTexture(const TextureResource& texture);
+        void updateTextureDescriptor(int descriptorSlot, VkImageView textureImage);
+        VkDescriptorSet allocateFrameDescriptorSet(VkDescriptorSetLayout layout);
+        VkDescriptorSet writeInputDescriptorSet();
+
+        // -- Mipmap functions
+        bool checkLinearBlitSupport(VkFormat format);
+        void recordMipmaps(VkCommandBuffer cmdBuffer, VkImage image, uint32_t width, uint32_t height,
+                           uint32_t mipLevels);
+
+        // -- Texture upload functions
+        TextureSource parseTextureSource(const std::string& fileName, std::vector<char> fileData);
+        TextureUpload stageTextureUpload(const TextureSource& source, uint32_t baseMip);
+        static void decodeTexture(TextureUpload& upload);
+        VkImage submitTextureUpload(TextureUpload& upload, VkDeviceMemory* imageMemory);
+        uint64_t submitTransferCommands(VkCommandBuffer cmdBuffer);
+        void releaseTextureUpload(TextureUpload& upload);
+        void releaseTextureUploads(std::vector<TextureUpload>& uploads);
+
+        // -- Texture streaming functions
+        void updateTextureStreaming();
+        void gatherTextureDemand();
+        void startTextureStream(const StreamRequest& request);
+        void recordTextureEviction(TextureStream& stream, int textureImage, uint32_t droppedLevels);
+
+        // -- Pipeline functions
+        VkPipeline buildPipeline(const PipelineDesc& desc);
+        void requestPipelineBuild(PipelineSlot& slot);
+        void updatePipelines();
+        static uint64_t hashPipelineDesc(const PipelineDesc& desc);
+        uint64_t requestPipelineVariant(const PipelineDesc& desc);
+        void retirePipelineVariant(uint64_t variant);
+        PipelineDesc getPostProcessDesc(PostProcessMode mode) const;
 
         // -- Loader Functions
-        stbi_uc* loadTextureFile(const std::string& fileName, int* width, int* height, VkDeviceSize* imageSize);
+        std::string findTextureFile(const std::string& fileName);
 
     private:
-        int currentFrame{0};
+        uint32_t framesInFlight{DEFAULT_FRAMES_IN_FLIGHT};
+        std::vector<FrameContext> frames;
+        uint32_t currentFrame{0};
 
         std::unique_ptr<Window>& window_;
         std::unique_ptr<ValidationLayers> validationLayers;
 
         // Scene objects
-        std::vector<MeshModel> modelList;
+        SlotMap<MeshModel> modelList;
+        GeometryHeap geometryHeap; // Vertex and index buffers of every mesh
+        ResourceRegistry resourceRegistry;
+        DeletionQueue deletionQueue; // Retired by graphics timeline value
+
+        // Workers for texture decoding
+        ThreadPool threadPool;
+
+        // Texture streaming, keyed by sampler descriptor set location
+        TextureStreamer textureStreamer;
+        std::unordered_map<int, TextureSource> textureSources;
+        std::list<TextureStream> textureStreams; // List so workers can keep pointers into it
+
+        // Screenshots and recording, encoded on the workers
+        FrameCapture frameCapture;
 
         // Scene Settings
         UboViewProjection uboViewProjection{};
 
+        // Draws of every mesh in state order, recompiled only when models are added or removed
+        std::vector<DrawPacket> drawPackets;
+        bool drawListDirty{true};
+
+        // Same draws front to back for this frame: (quantized view depth << 32 | packet index)
+        std::vector<uint64_t> drawKeys;
+        std::vector<uint64_t> drawKeysScratch;
+
+        // CPU copy of the object buffer, by model slot, only dirty records are uploaded
+        std::vector<ObjectData> objectData;
+        std::vector<uint32_t> dirtyObjects;
+        std::vector<bool> objectDirty; // Keeps dirtyObjects free of duplicates
+        glm::mat4 objectViewProjection{}; // Camera the uploaded records were multiplied with
+
         // Vulkan components
         // - Main
         VkInstance instance_{};
         Device device_{};
         VkQueue graphicsQueues_{};
+        GpuTimeline graphicsTimeline; // Frames, uploads and retirement are all ordered by its values
         VkQueue presentationQueue_{};
         VkSurfaceKHR surface_{};
         VkSwapchainKHR swapChain_{};
+        bool swapChainOutOfDate{false}; // Rebuild before the next frame (resize, out of date, suboptimal)
+        bool surfaceLost{false};
+        PresentPolicy presentPolicy{PresentPolicy::LOW_LATENCY};
+        FrameLimiter frameLimiter; // Off unless a limit is set
         std::vector<SwapChainImage> swapChainImages_;
-        std::vector<VkFramebuffer> swapChainFramebuffers_;
-        std::vector<VkCommandBuffer> commandBuffers_;
-        std::vector<VkImage> depthBufferImages;
-        std::vector<VkDeviceMemory> depthBufferImageMemory;
-        std::vector<VkImageView> depthBufferImageView;
-        std::vector<VkImage> colourBufferImages;
-        std::vector<VkDeviceMemory> colourBufferImageMemory;
-        std::vector<VkImageView> colourBufferImageView;
+        bool swapChainReadable{false}; // Images can be copied from (frame capture)
+        std::vector<VkFramebuffer> swapChainFramebuffers_; // One per frame in flight and swap chain image
+        // Intermediate attachments, one per frame in flight (transient, lazily allocated where the GPU supports it)
+        VkFormat colourBufferFormat{};
+        VkFormat depthBufferFormat{};
+        RenderGraphImages attachmentImages;
         VkSampler textureSampler{};
 
         // - Descriptors
         VkDescriptorSetLayout descriptorSetLayout{};
-        VkDescriptorPool descriptorPool{};
-        std::vector<VkBuffer> vpUniformBuffer;
-        std::vector<VkDeviceMemory> vpUniformBufferMemory;
-        std::vector<VkBuffer> modelDUniformBuffer;
-        std::vector<VkDeviceMemory> modelDUniformBufferMemory;
-        std::vector<VkDescriptorSet> descriptorSets;
+        DescriptorAllocator descriptorAllocator; // Sets that live as long as the renderer
+        std::vector<DescriptorPoolRatio> descriptorPoolRatios; // Shared by the frame allocators
+        VkBuffer vpUniformBuffer{}; // One slice per frame in flight, persistently mapped
+        VkDeviceMemory vpUniformBufferMemory{};
+        void* vpUniformData{};
+        VkDeviceSize vpUniformStride{}; // Slice size rounded up to the dynamic offset alignment
+        VkDescriptorSet vpDescriptorSet{}; // Dynamic uniform buffer, offset to the slice of the frame when bound (plus objects)
+        std::vector<VkDescriptorSet> freeVpDescriptorSets; // Replaced when the object buffer grew, no frame uses them
+        VkBuffer objectBuffer{}; // Device local ObjectData records, read by the vertex shaders
+        VkDeviceMemory objectBufferMemory{};
+        VkBuffer objectStagingBuffer{}; // One slice per frame in flight (as large as the object buffer), persistently mapped
+        VkDeviceMemory objectStagingBufferMemory{};
+        void* objectStagingData{};
+        uint32_t objectCapacity{};
 //        VkDeviceSize minUniformBufferOffset_{};
 //        size_t modelUniformAlignment{};
 //        UboModel* modelTransferSpace{};
-        VkPushConstantRange pushConstantRange{};
-        VkDescriptorPool samplerDescriptorPool{};
+        std::vector<VkPushConstantRange> pushConstantRanges;
+        VkDescriptorPool samplerDescriptorPool{}; // Only for the bindless set
         VkDescriptorSetLayout samplerSetLayout{};
         std::vector<VkDescriptorSet> samplerDescriptorSets;
-        VkDescriptorSetLayout inputSetLayout{};
-        VkDescriptorPool inputDescriptorPool{};
-        std::vector<VkDescriptorSet> inputDescriptorSets{};
+        bool bindlessTextures{false}; // One descriptor set with every texture, instead of one set per texture
+        uint32_t maxBindlessTextures{};
+        uint32_t bindlessTextureCount{};
+        VkDescriptorSet bindlessDescriptorSet{};
+        VkDescriptorSetLayout inputSetLayout{}; // Sets are written every frame, from the frame's allocator
 
         // - Assets
         std::vector<VkImage> textureImages;
         std::vector<VkDeviceMemory> textureImageMemory;
         std::vector<VkImageView> textureImageViews;
+        std::vector<uint32_t> textureMipLevels;
+        std::vector<VkFormat> textureFormats;
+        std::vector<int> freeTextureImages; // Slots of destroyed textures, reused by the next ones
+        // Texture ids (the descriptorLoc meshes, registry and streamer know a texture by) to the descriptor it is sampled
+        // through: bindless array element or per texture set. Streaming writes a swapped image into a new descriptor, as
+        // the current one may still be read by frames in flight
+        std::vector<int> textureDescriptorSlots;
+        std::vector<int> freeTextureIds;
+        std::vector<int> freeTextureDescriptors; // Descriptors no frame in flight reads anymore
 
         // - Pipeline
         VkPipeline graphicsPipeline_{};
+        VkPipeline depthPrePassPipeline{}; // Position only, depth write
+        VkPipeline depthEqualPipeline{}; // Scene pipeline for after the pre-pass (EQUAL test, no depth write)
+        bool depthPrePass{true}; // The pre-pass subpass stays in the render pass either way, empty when off
         VkPipelineLayout pipelineLayout{};
-        VkRenderPass renderPass_{};
-        VkPipeline secondPipeline{};
+        VkRenderPass renderPass_{}; // Compiled from the render graph
+        RenderGraph renderGraph;
+        RenderGraphResource swapChainAttachment{};
+        RenderGraphResource colourAttachment{};
+        RenderGraphResource depthAttachment{};
+        uint32_t depthPrePassPass{};
+        uint32_t scenePass{};
+        uint32_t postProcessPass{};
+        VkPipeline secondPipeline{}; // Post process variant of the current mode, owned by pipelineVariants
         VkPipelineLayout secondPipeLineLayout{};
+        PipelineCache pipelineCache{"pipeline_cache.bin"};
+        std::vector<PipelineSlot> pipelineSlots;
+        std::unordered_map<uint64_t, VkPipeline> pipelineVariants; // By description hash, null until built
+        PostProcessMode postProcessMode{PostProcessMode::SPLIT};
+        uint64_t postProcessVariant{}; // Variant secondPipeline follows once it is built
+        uint64_t splitVariant{}; // The split position is baked in, one per window width
+        VkPipeline retiredSecondPipeline{}; // Retired variant still bound, destroyed once secondPipeline moves on
+        std::vector<std::future<VkPipeline>> discardedBuilds; // Builds of retired variants, destroyed when they land
+        ShaderRegistry shaderRegistry;
+        ShaderWatcher shaderWatcher;
 
         // Pools
         VkCommandPool graphicsCommandPool{};
 
         // - Utility
         VkFormat swapChainImageFormat_{};
+        VkColorSpaceKHR swapChainColorSpace_{};
         VkExtent2D swapChainExtent_{};
-
-        // - Synchronisation
-        std::vector<VkSemaphore> imageAvailable;
-        std::vector<VkSemaphore> renderFinished;
-        std::vector<VkFence> drawFences;
 };
 
 
@@ -10,10 +10,14 @@ Window::Window(const std::string& name, const int width, const int height) : wid
 
     // Set GLFW to NOT work with OpenGL
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
     spdlog::info("[GLFW] Create window");
     window_ = glfwCreateWindow(width_, height_, name.c_str(), nullptr, nullptr);
+
+    // Resizes are picked up by the renderer on its next frame
+    glfwSetWindowUserPointer(window_, this);
+    glfwSetFramebufferSizeCallback(window_, framebufferResizeCallback);
 }
 
 Window::~Window() = default;
@@ -22,6 +26,13 @@ bool Window::isOpen() {
     return !glfwWindowShouldClose(window_);
 }
 
+void Window::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
+    auto* self = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    self->width_ = width;
+    self->height_ = height;
+    self->framebufferResized_ = true;
+}
+
 void Window::clean() {
     spdlog::info("[GLFW] Clean window");
     glfwDestroyWindow(window_);
@@ -18,9 +18,13 @@ class Window {
         bool isOpen();
         void clean();
 
+    private:
+        static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+
     private:
         GLFWwindow* window_;
         int width_, height_;
+        bool framebufferResized_{false}; // Set by GLFW, cleared by the renderer once the swap chain is rebuilt
 };
 
 
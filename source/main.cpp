@@ -19,7 +19,7 @@ int main() {
     float deltaTime = 0.0f;
     float lastTime = 0.0f;
 
-    int helicopter = renderer->createMeshModel("../assets/models/uh60.obj");
+    ModelHandle helicopter = renderer->createMeshModel("../assets/models/uh60.obj");
 
     while (window->isOpen()) {
         glfwPollEvents();
@@ -0,0 +1,257 @@
+// Offline texture encoder: converts every image in a directory into a BC1/BC3 KTX2 file with a full mip chain
+// Usage: texture-encoder [input directory] [output directory]
+
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+#include "spdlog/spdlog.h"
+#include <stb_image.h>
+
+#include "../source/Ktx2Texture.hpp"
+#include "../source/MipChain.hpp"
+
+
+static uint16_t packColour565(const uint8_t* colour) {
+    return static_cast<uint16_t>(((colour[0] >> 3) << 11) | ((colour[1] >> 2) << 5) | (colour[2] >> 3));
+}
+
+static std::array<int, 3> unpackColour565(uint16_t colour) {
+    int r = (colour >> 11) & 31;
+    int g = (colour >> 5) & 63;
+    int b = colour & 31;
+
+    return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+}
+
+// Encode the colour of a 4x4 RGBA block (64 bytes) into 8 bytes of BC1 (4 colour mode)
+// Endpoints are the inset bounding box of the block colours, good quality for the cost
+static void encodeColourBlock(const uint8_t* block, uint8_t* out) {
+    std::array<int, 3> minColour = { 255, 255, 255 };
+    std::array<int, 3> maxColour = { 0, 0, 0 };
+
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            minColour[c] = std::min(minColour[c], static_cast<int>(block[i * 4 + c]));
+            maxColour[c] = std::max(maxColour[c], static_cast<int>(block[i * 4 + c]));
+        }
+    }
+
+    // Inset the box by 1/16 of its size to reduce the error from outliers
+    uint8_t endpoints[2][3];
+
+    for (int c = 0; c < 3; ++c) {
+        int inset = (maxColour[c] - minColour[c]) >> 4;
+        endpoints[0][c] = static_cast<uint8_t>(std::min(maxColour[c] - inset, 255));
+        endpoints[1][c] = static_cast<uint8_t>(std::max(minColour[c] + inset, 0));
+    }
+
+    uint16_t colour0 = packColour565(endpoints[0]);
+    uint16_t colour1 = packColour565(endpoints[1]);
+
+    // colour0 > colour1 selects the opaque 4 colour mode
+    if (colour0 < colour1) std::swap(colour0, colour1);
+
+    uint32_t indices = 0;
+
+    if (colour0 != colour1) {
+        std::array<int, 3> p0 = unpackColour565(colour0);
+        std::array<int, 3> p1 = unpackColour565(colour1);
+        std::array<std::array<int, 3>, 4> palette{};
+
+        for (int c = 0; c < 3; ++c) {
+            palette[0][c] = p0[c];
+            palette[1][c] = p1[c];
+            palette[2][c] = (2 * p0[c] + p1[c]) / 3;
+            palette[3][c] = (p0[c] + 2 * p1[c]) / 3;
+        }
+
+        for (int i = 0; i < 16; ++i) {
+            int bestIndex = 0;
+            int bestError = std::numeric_limits<int>::max();
+
+            for (int p = 0; p < 4; ++p) {
+                int error = 0;
+
+                for (int c = 0; c < 3; ++c) {
+                    int diff = block[i * 4 + c] - palette[p][c];
+                    error += diff * diff;
+                }
+
+                if (error < bestError) {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+
+            indices |= static_cast<uint32_t>(bestIndex) << (i * 2);
+        }
+    }
+
+    out[0] = colour0 & 0xFF;
+    out[1] = colour0 >> 8;
+    out[2] = colour1 & 0xFF;
+    out[3] = colour1 >> 8;
+
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = (indices >> (i * 8)) & 0xFF;
+    }
+}
+
+// Encode the alpha of a 4x4 RGBA block into 8 bytes of BC3 alpha (8 alpha mode)
+static void encodeAlphaBlock(const uint8_t* block, uint8_t* out) {
+    int minAlpha = 255;
+    int maxAlpha = 0;
+
+    for (int i = 0; i < 16; ++i) {
+        minAlpha = std::min(minAlpha, static_cast<int>(block[i * 4 + 3]));
+        maxAlpha = std::max(maxAlpha, static_cast<int>(block[i * 4 + 3]));
+    }
+
+    out[0] = static_cast<uint8_t>(maxAlpha);
+    out[1] = static_cast<uint8_t>(minAlpha);
+
+    // alpha0 > alpha1 selects 6 interpolated values between the endpoints
+    std::array<int, 8> palette{ maxAlpha, minAlpha };
+
+    for (int i = 1; i < 7; ++i) {
+        palette[i + 1] = ((7 - i) * maxAlpha + i * minAlpha) / 7;
+    }
+
+    uint64_t indices = 0;
+
+    if (maxAlpha != minAlpha) {
+        for (int i = 0; i < 16; ++i) {
+            int bestIndex = 0;
+            int bestError = std::numeric_limits<int>::max();
+
+            for (int p = 0; p < 8; ++p) {
+                int error = std::abs(block[i * 4 + 3] - palette[p]);
+
+                if (error < bestError) {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+
+            indices |= static_cast<uint64_t>(bestIndex) << (i * 3);
+        }
+    }
+
+    for (int i = 0; i < 6; ++i) {
+        out[2 + i] = (indices >> (i * 8)) & 0xFF;
+    }
+}
+
+static std::vector<uint8_t> encodeLevel(const uint8_t* pixels, uint32_t width, uint32_t height, bool hasAlpha) {
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    size_t blockBytes = hasAlpha ? 16 : 8;
+
+    std::vector<uint8_t> encoded(blocksX * blocksY * blockBytes);
+    uint8_t block[64];
+
+    for (uint32_t by = 0; by < blocksY; ++by) {
+        for (uint32_t bx = 0; bx < blocksX; ++bx) {
+            // Gather the block, clamping to the edge for levels smaller than (or not a multiple of) 4
+            for (uint32_t y = 0; y < 4; ++y) {
+                for (uint32_t x = 0; x < 4; ++x) {
+                    uint32_t px = std::min(bx * 4 + x, width - 1);
+                    uint32_t py = std::min(by * 4 + y, height - 1);
+                    std::memcpy(&block[(y * 4 + x) * 4], &pixels[(py * width + px) * 4], 4);
+                }
+            }
+
+            uint8_t* out = &encoded[(by * blocksX + bx) * blockBytes];
+
+            if (hasAlpha) {
+                encodeAlphaBlock(block, out);
+                encodeColourBlock(block, out + 8);
+            } else {
+                encodeColourBlock(block, out);
+            }
+        }
+    }
+
+    return encoded;
+}
+
+static void encodeTexture(const std::filesystem::path& input, const std::filesystem::path& output) {
+    int width, height, channels;
+    stbi_uc* image = stbi_load(input.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+    if (!image) throw std::runtime_error("Failed to load a Texture file: " + input.string());
+
+    // Opaque images only need BC1 (4 bits per texel), anything with alpha goes to BC3 (8 bits per texel)
+    bool hasAlpha = false;
+
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i) {
+        if (image[i * 4 + 3] != 255) {
+            hasAlpha = true; break;
+        }
+    }
+
+    uint32_t mipLevels = getMipLevels(width, height);
+    std::vector<std::vector<uint8_t>> levels;
+
+    // Filter each level from the previous uncompressed one, not from the compressed result
+    std::vector<uint8_t> pixels(image, image + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(image);
+
+    uint32_t mipWidth = width;
+    uint32_t mipHeight = height;
+
+    for (uint32_t i = 0; i < mipLevels; ++i) {
+        levels.push_back(encodeLevel(pixels.data(), mipWidth, mipHeight, hasAlpha));
+
+        if (i + 1 < mipLevels) {
+            std::vector<uint8_t> nextPixels(std::max(mipWidth / 2, 1u) * std::max(mipHeight / 2, 1u) * 4);
+            downsampleImage(pixels.data(), mipWidth, mipHeight, nextPixels.data());
+
+            pixels = std::move(nextPixels);
+            mipWidth = std::max(mipWidth / 2, 1u);
+            mipHeight = std::max(mipHeight / 2, 1u);
+        }
+    }
+
+    VkFormat format = hasAlpha ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    std::vector<char> fileData = Ktx2Texture::write(format, width, height, levels);
+
+    std::ofstream file(output, std::ios::binary);
+
+    if (!file.is_open()) throw std::runtime_error("Failed to open " + output.string() + " file");
+
+    file.write(fileData.data(), static_cast<std::streamsize>(fileData.size()));
+
+    spdlog::info("[Texture-Encoder] {} -> {} ({}, {} levels)", input.filename().string(), output.filename().string(),
+                 hasAlpha ? "BC3" : "BC1", mipLevels);
+}
+
+int main(int argc, char** argv) {
+    std::filesystem::path inputDir = argc > 1 ? argv[1] : "../assets/images";
+    std::filesystem::path outputDir = argc > 2 ? argv[2] : inputDir;
+
+    const std::vector<std::string> imageExtensions = { ".jpg", ".jpeg", ".png", ".tga", ".gif", ".bmp" };
+
+    try {
+        std::filesystem::create_directories(outputDir);
+
+        for (const auto& entry : std::filesystem::directory_iterator(inputDir)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+            if (std::find(imageExtensions.begin(), imageExtensions.end(), extension) == imageExtensions.end()) continue;
+
+            encodeTexture(entry.path(), outputDir / (entry.path().stem().string() + ".ktx2"));
+        }
+    } catch (const std::exception& error) {
+        spdlog::error("[Texture-Encoder] {}", error.what());
+
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}